@@ -0,0 +1,42 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+using namespace frontend;
+
+namespace {
+    constexpr std::size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+    std::byte* alignUp(std::byte* pointer, std::size_t align) {
+        auto address = reinterpret_cast<std::uintptr_t>(pointer);
+        return pointer + ((align - (address % align)) % align);
+    }
+}
+
+AstArena::~AstArena() {
+    // backwards, so nodes go in the opposite order they were made in.
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+void AstArena::newChunk(std::size_t minimum) {
+    std::size_t size = std::max(nextChunkSize, minimum);
+    chunks.emplace_back(new std::byte[size]);
+    cursor = chunks.back().get();
+    limit = cursor + size;
+    reserved += size;
+    nextChunkSize = std::min(nextChunkSize * 2, MAX_CHUNK_SIZE);
+}
+
+void* AstArena::allocate(std::size_t size, std::size_t align) {
+    std::byte* memory = cursor ? alignUp(cursor, align) : nullptr;
+    if (memory == nullptr || memory > limit || static_cast<std::size_t>(limit - memory) < size) {
+        newChunk(size + align);
+        memory = alignUp(cursor, align);
+    }
+
+    cursor = memory + size;
+    used += size;
+    return memory;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+    // bump allocator that owns every node of one produceAST call. nodes are laid out back to back
+    // in the order theyre made, and the whole thing (destructors included) goes away with the arena.
+    class AstArena {
+    public:
+        AstArena() {}
+        ~AstArena();
+
+        AstArena(const AstArena&) = delete;
+        AstArena& operator=(const AstArena&) = delete;
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args) {
+            T* node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                destructors.push_back({node, [](void* object) { static_cast<T*>(object)->~T(); }});
+            }
+            return node;
+        }
+
+        void* allocate(std::size_t size, std::size_t align);
+
+        std::size_t bytesUsed() const {
+            return used;
+        }
+        std::size_t bytesReserved() const {
+            return reserved;
+        }
+    private:
+        struct Destructor {
+            void* object;
+            void (*destroy)(void*);
+        };
+
+        void newChunk(std::size_t minimum);
+
+        std::vector<std::unique_ptr<std::byte[]>> chunks;
+        std::vector<Destructor> destructors;
+        std::byte* cursor = nullptr;
+        std::byte* limit = nullptr;
+        std::size_t nextChunkSize = 16 * 1024;
+        std::size_t used = 0;
+        std::size_t reserved = 0;
+    };
+}
\ No newline at end of file
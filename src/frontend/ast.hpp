@@ -1,10 +1,15 @@
 #pragma once
+#include <cstdint>
 #include <optional>
+#include <span>
+#include "symbols.hpp"
+#include "arena.hpp"
+#include "../runtime/property_cache.hpp"
 
 namespace frontend {
     class AST {
         public:
-        enum class NodeType {
+        enum class NodeType : std::uint8_t {
             Program, // 0
             NumericLiteral, // 1
             Identifier, // 2
@@ -21,7 +26,69 @@ namespace frontend {
             CompExpr, // 13
             StringLiteral, // 14
             While, // 15
-            BreakStmt // 16
+            BreakStmt, // 16
+            ContinueStmt, // 17
+            ReturnStmt, // 18
+
+            // nothing but the tree walker makes these, it rewrites a node into one once it has seen
+            // what the node works on, and back when that stops being true.
+            IntBinaryExpr, // 19: a BinEx that has only seen numbers
+            IntCompExpr, // 20: a CompEx that has only seen numbers
+            CachedMemberExpr // 21: a MemberExpr with an inline cache of the shapes it has seen
+        };
+
+        static constexpr std::size_t NODE_TYPE_COUNT = static_cast<std::size_t>(NodeType::CachedMemberExpr) + 1;
+
+        // operators are picked once by the parser, so the interpreter never compares strings.
+        enum class BinaryOp : std::uint8_t {
+            Add, // +
+            Sub, // -
+            Mul, // *
+            Div, // /
+            Mod // %
+        };
+
+        enum class CompareOp : std::uint8_t {
+            Less, // <
+            Greater, // >
+            Equal, // ==
+            GreaterEqual, // >=
+            LessEqual // <=
+        };
+
+        static const char* opText(BinaryOp op) {
+            switch (op) {
+                case BinaryOp::Add: return "+";
+                case BinaryOp::Sub: return "-";
+                case BinaryOp::Mul: return "*";
+                case BinaryOp::Div: return "/";
+                default: return "%";
+            }
+        }
+
+        static const char* opText(CompareOp op) {
+            switch (op) {
+                case CompareOp::Less: return "<";
+                case CompareOp::Greater: return ">";
+                case CompareOp::Equal: return "==";
+                case CompareOp::GreaterEqual: return ">=";
+                default: return "<=";
+            }
+        }
+
+        // child lists are a pointer + length into the program's arena,
+        // a deque costs hundreds of bytes even when it only holds one or two things.
+        template <typename T>
+        struct List {
+            T* items = nullptr;
+            std::uint32_t count = 0;
+
+            T* begin() const { return items; }
+            T* end() const { return items + count; }
+            std::size_t size() const { return count; }
+            bool empty() const { return count == 0; }
+            T& operator[](std::size_t index) const { return items[index]; }
+            operator std::span<const T>() const { return {items, count}; }
         };
 
         struct Stmt {
@@ -30,11 +97,17 @@ namespace frontend {
             NodeType kind;
         };
 
+        // the program owns the arena every other node lives in, dropping it frees the whole tree.
         struct Program : public Stmt {
             Program() {
                 this->kind = NodeType::Program;
             }
-            std::deque<Stmt*> body;
+            List<Stmt*> body;
+            // every name in the global scope by slot, builtins first. set by the resolver.
+            List<SymbolId> globals;
+            std::unique_ptr<AstArena> arena = std::make_unique<AstArena>();
+            // how many of each node the parser made, for --ast-stats.
+            std::uint32_t nodeCounts[NODE_TYPE_COUNT] = {};
         };
 
         struct Expr : public Stmt {Expr(){}};
@@ -45,7 +118,8 @@ namespace frontend {
             }
 
             bool constant;
-            std::string identifier;
+            SymbolId identifier;
+            std::uint32_t slot = 0; // in the scope it declares into
             std::optional<Expr*> value;
         };
 
@@ -55,7 +129,8 @@ namespace frontend {
             }
             Expr* left;
             Expr* right;
-            std::string op;
+            BinaryOp op;
+            bool generic = false; // an IntBinaryExpr guard failed, it doesn't get specialized again
         };
 
         struct Identifier : public Expr {
@@ -63,7 +138,11 @@ namespace frontend {
                 this->kind = NodeType::Identifier;
             }
 
-            std::string symbol;
+            SymbolId symbol;
+            // where the resolver found it: how many function scopes up, and the slot in that scope.
+            // property names in a MemberExpr are left alone.
+            std::uint32_t depth = 0;
+            std::uint32_t slot = 0;
         };
 
         struct NumericLiteral : public Expr {
@@ -87,7 +166,7 @@ namespace frontend {
                 this->kind = NodeType::Property;
             }
 
-            std::string key;
+            SymbolId key;
             std::optional<Expr*> value;
         };
     
@@ -96,16 +175,18 @@ namespace frontend {
                 this->kind = NodeType::ObjectLiteral;
             }
 
-            std::deque<Property*> properties;
+            List<Property*> properties;
         };
 
         struct CallExpr : public Expr {
             CallExpr() {
                 this->kind = NodeType::CallExpr;
             }
-            std::deque<Expr*> args;
+            List<Expr*> args;
             Expr* caller;
-            std::string op;
+            // set by the resolver when nothing runs after the call in its function and that function's
+            // scope can't be captured, so the call can take over the caller's frame.
+            bool tail = false;
         };
 
         struct MemberExpr : public Expr {
@@ -114,6 +195,9 @@ namespace frontend {
             }
             Expr* object;
             Expr* property;
+            // the tree walker's inline cache for this site, used while it's a CachedMemberExpr.
+            runtime::PropertyCache cache;
+            bool generic = false;
         };
 
         struct FunDeclare : public Stmt {
@@ -121,9 +205,14 @@ namespace frontend {
                 this->kind = NodeType::FunctionDeclaration;
             }
 
-            std::deque<std::string> parameters;
-            std::string name;
-            std::deque<Stmt*> body;
+            List<SymbolId> parameters;
+            SymbolId name;
+            std::uint32_t slot = 0; // of the name, in the declaring scope
+            // every name in the function's own scope by slot, the parameters come first.
+            List<SymbolId> locals;
+            List<Stmt*> body;
+            // declares functions of its own, which can keep a call's scope alive. set by the resolver.
+            bool captured = false;
         };
 
         struct ElseStmt : public Stmt {
@@ -132,7 +221,7 @@ namespace frontend {
             }
 
             bool multiline;
-            std::deque<AST::Stmt*> body;
+            List<Stmt*> body;
         };
 
         struct IfStmt : public Stmt {
@@ -142,14 +231,18 @@ namespace frontend {
 
             AST::Expr* condition;
             bool multiline;
-            std::deque<AST::Stmt*> body;
+            List<Stmt*> body;
             std::optional<AST::ElseStmt*> elseStmt;
         };
 
-        struct CompEx : public BinEx {
+        struct CompEx : public Expr {
             CompEx() {
                 kind=AST::NodeType::CompExpr;
             }
+            Expr* left;
+            Expr* right;
+            CompareOp op;
+            bool generic = false;
         };
 
         struct StringLiteral : public Expr {
@@ -167,7 +260,7 @@ namespace frontend {
 
             AST::Expr* condition;
             bool multiline;
-            std::deque<AST::Stmt*> body;
+            List<Stmt*> body;
         };
 
         struct BreakStmt : public Stmt {
@@ -175,5 +268,57 @@ namespace frontend {
                 this->kind = NodeType::BreakStmt;
             }
         };
+
+        struct ContinueStmt : public Stmt {
+            ContinueStmt() {
+                this->kind = NodeType::ContinueStmt;
+            }
+        };
+
+        struct ReturnStmt : public Stmt {
+            ReturnStmt() {
+                this->kind = NodeType::ReturnStmt;
+            }
+
+            std::optional<Expr*> value; // returns null without one
+        };
+
+        static const char* nodeName(NodeType type) {
+            static const char* names[NODE_TYPE_COUNT] = {
+                "Program", "NumericLiteral", "Identifier", "BinaryExpr", "VarDeclare", "AssignmentExpr",
+                "Property", "ObjectLiteral", "MemberExpr", "CallExpr", "FunctionDeclaration", "If", "Else",
+                "CompExpr", "StringLiteral", "While", "BreakStmt", "ContinueStmt", "ReturnStmt",
+                "IntBinaryExpr", "IntCompExpr", "CachedMemberExpr"
+            };
+            return names[static_cast<std::size_t>(type)];
+        }
+
+        static std::size_t nodeSize(NodeType type) {
+            switch (type) {
+                case NodeType::Program: return sizeof(Program);
+                case NodeType::NumericLiteral: return sizeof(NumericLiteral);
+                case NodeType::Identifier: return sizeof(Identifier);
+                case NodeType::BinaryExpr: return sizeof(BinEx);
+                case NodeType::VarDeclare: return sizeof(VarDeclare);
+                case NodeType::AssignmentExpr: return sizeof(AssignExpr);
+                case NodeType::Property: return sizeof(Property);
+                case NodeType::ObjectLiteral: return sizeof(ObjectLiteral);
+                case NodeType::MemberExpr: return sizeof(MemberExpr);
+                case NodeType::CallExpr: return sizeof(CallExpr);
+                case NodeType::FunctionDeclaration: return sizeof(FunDeclare);
+                case NodeType::If: return sizeof(IfStmt);
+                case NodeType::Else: return sizeof(ElseStmt);
+                case NodeType::CompExpr: return sizeof(CompEx);
+                case NodeType::StringLiteral: return sizeof(StringLiteral);
+                case NodeType::While: return sizeof(WhileStmt);
+                case NodeType::BreakStmt: return sizeof(BreakStmt);
+                case NodeType::ContinueStmt: return sizeof(ContinueStmt);
+                case NodeType::ReturnStmt: return sizeof(ReturnStmt);
+                case NodeType::IntBinaryExpr: return sizeof(BinEx);
+                case NodeType::IntCompExpr: return sizeof(CompEx);
+                case NodeType::CachedMemberExpr: return sizeof(MemberExpr);
+            }
+            return 0;
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "ast_printer.hpp"
+#include <fmt/core.h>
+
+using namespace frontend;
+
+std::string AstPrinter::print(AST::Stmt* root) {
+    AstPrinter printer;
+    printer.node(root, 0);
+    return std::move(printer.out);
+}
+
+void AstPrinter::line(int depth, const std::string& text) {
+    out.append(depth * 2, ' ');
+    out += text;
+    out += '\n';
+}
+
+void AstPrinter::block(const char* label, const AST::List<AST::Stmt*>& body, int depth) {
+    line(depth, label);
+    for (auto stmt : body) {
+        node(stmt, depth + 1);
+    }
+}
+
+void AstPrinter::node(AST::Stmt* stmt, int depth) {
+    auto name = AST::nodeName(stmt->kind);
+    switch (stmt->kind) {
+        case AST::NodeType::Program: {
+            auto program = static_cast<AST::Program*>(stmt);
+            line(depth, fmt::format("{} ({} globals)", name, program->globals.size()));
+            for (auto child : program->body) {
+                node(child, depth + 1);
+            }
+            break;
+        }
+        case AST::NodeType::NumericLiteral: {
+            line(depth, fmt::format("{} {}", name, static_cast<AST::NumericLiteral*>(stmt)->value));
+            break;
+        }
+        case AST::NodeType::StringLiteral: {
+            line(depth, fmt::format("{} \"{}\"", name, static_cast<AST::StringLiteral*>(stmt)->value));
+            break;
+        }
+        case AST::NodeType::Identifier: {
+            auto ident = static_cast<AST::Identifier*>(stmt);
+            line(depth, fmt::format("{} {} @{}:{}", name, Symbols::name(ident->symbol), ident->depth, ident->slot));
+            break;
+        }
+        case AST::NodeType::BinaryExpr:
+        case AST::NodeType::IntBinaryExpr: {
+            auto binop = static_cast<AST::BinEx*>(stmt);
+            line(depth, fmt::format("{} {}", name, AST::opText(binop->op)));
+            node(binop->left, depth + 1);
+            node(binop->right, depth + 1);
+            break;
+        }
+        case AST::NodeType::CompExpr:
+        case AST::NodeType::IntCompExpr: {
+            auto compEx = static_cast<AST::CompEx*>(stmt);
+            line(depth, fmt::format("{} {}", name, AST::opText(compEx->op)));
+            node(compEx->left, depth + 1);
+            node(compEx->right, depth + 1);
+            break;
+        }
+        case AST::NodeType::VarDeclare: {
+            auto declaration = static_cast<AST::VarDeclare*>(stmt);
+            line(depth, fmt::format("{} {}{} @{}", name, declaration->constant ? "const " : "", Symbols::name(declaration->identifier), declaration->slot));
+            if (declaration->value) {
+                node(declaration->value.value(), depth + 1);
+            }
+            break;
+        }
+        case AST::NodeType::AssignmentExpr: {
+            auto assignment = static_cast<AST::AssignExpr*>(stmt);
+            line(depth, name);
+            node(assignment->assigne, depth + 1);
+            node(assignment->value, depth + 1);
+            break;
+        }
+        case AST::NodeType::Property: {
+            auto prop = static_cast<AST::Property*>(stmt);
+            line(depth, fmt::format("{} {}", name, Symbols::name(prop->key)));
+            if (prop->value) {
+                node(prop->value.value(), depth + 1);
+            }
+            break;
+        }
+        case AST::NodeType::ObjectLiteral: {
+            line(depth, name);
+            for (auto prop : static_cast<AST::ObjectLiteral*>(stmt)->properties) {
+                node(prop, depth + 1);
+            }
+            break;
+        }
+        case AST::NodeType::MemberExpr:
+        case AST::NodeType::CachedMemberExpr: {
+            auto member = static_cast<AST::MemberExpr*>(stmt);
+            line(depth, fmt::format("{} .{}", name, Symbols::name(static_cast<AST::Identifier*>(member->property)->symbol)));
+            node(member->object, depth + 1);
+            break;
+        }
+        case AST::NodeType::CallExpr: {
+            auto call = static_cast<AST::CallExpr*>(stmt);
+            line(depth, fmt::format("{}{}", name, call->tail ? " (tail)" : ""));
+            node(call->caller, depth + 1);
+            for (auto arg : call->args) {
+                node(arg, depth + 1);
+            }
+            break;
+        }
+        case AST::NodeType::FunctionDeclaration: {
+            auto declaration = static_cast<AST::FunDeclare*>(stmt);
+            std::string params;
+            for (auto param : declaration->parameters) {
+                if (!params.empty()) params += ", ";
+                params += Symbols::name(param);
+            }
+            line(depth, fmt::format("{} {}({}) @{}, {} locals{}", name, Symbols::name(declaration->name), params, declaration->slot, declaration->locals.size(), declaration->captured ? ", captured" : ""));
+            for (auto child : declaration->body) {
+                node(child, depth + 1);
+            }
+            break;
+        }
+        case AST::NodeType::If: {
+            auto ifstmt = static_cast<AST::IfStmt*>(stmt);
+            line(depth, name);
+            node(ifstmt->condition, depth + 1);
+            block("then", ifstmt->body, depth + 1);
+            if (ifstmt->elseStmt) {
+                block("else", ifstmt->elseStmt.value()->body, depth + 1);
+            }
+            break;
+        }
+        case AST::NodeType::While: {
+            auto whilestmt = static_cast<AST::WhileStmt*>(stmt);
+            line(depth, name);
+            node(whilestmt->condition, depth + 1);
+            block("do", whilestmt->body, depth + 1);
+            break;
+        }
+        case AST::NodeType::ReturnStmt: {
+            auto returnstmt = static_cast<AST::ReturnStmt*>(stmt);
+            line(depth, name);
+            if (returnstmt->value) {
+                node(returnstmt->value.value(), depth + 1);
+            }
+            break;
+        }
+        default: {
+            line(depth, name);
+            break;
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include "ast.hpp"
+
+namespace frontend {
+    // the tree as indented text, one node a line with whatever the node holds after its name.
+    // for --dump-ast, so what the optimizer does can be looked at.
+    class AstPrinter {
+    public:
+        static std::string print(AST::Stmt* root);
+    private:
+        std::string out;
+
+        void node(AST::Stmt* stmt, int depth);
+        void block(const char* label, const AST::List<AST::Stmt*>& body, int depth);
+        void line(int depth, const std::string& text);
+    };
+}
@@ -0,0 +1,204 @@
+#include "cache.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace frontend;
+
+namespace {
+    constexpr char MAGIC[4] = {'Y', 'H', 'S', 'C'};
+    // bump this whenever FlatAST's layout or the meaning of its fields changes.
+    constexpr std::uint32_t FORMAT_VERSION = 6;
+    constexpr std::uint32_t ENDIAN_CHECK = 0x01020304;
+
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t nodeSize;
+        std::uint32_t endianCheck;
+        std::uint64_t sourceHash;
+        std::uint64_t sourceSize;
+        std::uint32_t nodeCount;
+        std::uint32_t listCount;
+        std::uint32_t stringCount; // offsets, so one more than there are strings
+        std::uint32_t symbolCount;
+        std::uint64_t stringBytes;
+        std::uint64_t symbolBytes;
+        // everything after the header. the loader trusts every index in there, so a file that was
+        // damaged after it was written has to be caught before anything reads it.
+        std::uint64_t payloadHash;
+    };
+
+    // every section starts 8 byte aligned, so the mapped file can be used without copying.
+    std::size_t padded(std::size_t size) {
+        return (size + 7) & ~static_cast<std::size_t>(7);
+    }
+
+    struct Layout {
+        std::size_t nodes, lists, stringOffsets, stringData, symbolOffsets, symbolData, end;
+
+        explicit Layout(const Header& header) {
+            nodes = padded(sizeof(Header));
+            lists = nodes + padded(header.nodeCount * sizeof(FlatAST::Node));
+            stringOffsets = lists + padded(header.listCount * sizeof(std::uint32_t));
+            stringData = stringOffsets + padded(header.stringCount * sizeof(std::uint32_t));
+            symbolOffsets = stringData + padded(header.stringBytes);
+            symbolData = symbolOffsets + padded((header.symbolCount + 1) * sizeof(std::uint32_t));
+            end = symbolData + header.symbolBytes;
+        }
+    };
+
+    template <typename T>
+    std::span<const T> section(std::string_view file, std::size_t offset, std::size_t count) {
+        return std::span<const T>(reinterpret_cast<const T*>(file.data() + offset), count);
+    }
+
+    void writePadded(std::string& out, const void* data, std::size_t size) {
+        out.append(static_cast<const char*>(data), size);
+        out.append(padded(size) - size, '\0');
+    }
+}
+
+std::string ScriptCache::pathFor(const std::string& sourcePath) {
+    return std::filesystem::path(sourcePath).replace_extension(".yhsc").string();
+}
+
+std::optional<FlatAST> ScriptCache::load(const std::string& cachePath, std::string_view source) {
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(cachePath, error)) return std::nullopt;
+
+    auto file = utils::readFile(cachePath);
+    std::string_view bytes = file->contents;
+    if (bytes.size() < sizeof(Header)) return std::nullopt;
+
+    Header header;
+    std::memcpy(&header, bytes.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION ||
+        header.nodeSize != sizeof(FlatAST::Node) || header.endianCheck != ENDIAN_CHECK) {
+        return std::nullopt;
+    }
+    if (header.sourceSize != source.size() || header.sourceHash != utils::hashBytes(source)) {
+        return std::nullopt;
+    }
+
+    // sizes this big would wrap the layout around.
+    if (header.stringBytes > bytes.size() || header.symbolBytes > bytes.size()) return std::nullopt;
+    Layout layout(header);
+    if (layout.end > bytes.size() || header.nodeCount == 0 || header.stringCount == 0) return std::nullopt;
+    if (header.payloadHash != utils::hashBytes(bytes.substr(layout.nodes, layout.end - layout.nodes))) {
+        return std::nullopt;
+    }
+
+    FlatAST ast;
+    ast.nodes = section<FlatAST::Node>(bytes, layout.nodes, header.nodeCount);
+    ast.lists = section<std::uint32_t>(bytes, layout.lists, header.listCount);
+    ast.stringOffsets = section<std::uint32_t>(bytes, layout.stringOffsets, header.stringCount);
+    ast.stringData = bytes.substr(layout.stringData, header.stringBytes);
+
+    // symbol ids in the file are the ids the compiling process used. a fresh process interns the
+    // builtins in the same order, so re-interning the names normally gives back the exact same ids.
+    auto symbolOffsets = section<std::uint32_t>(bytes, layout.symbolOffsets, header.symbolCount + 1);
+    auto symbolData = bytes.substr(layout.symbolData, header.symbolBytes);
+    std::vector<SymbolId> remap(header.symbolCount);
+    bool fixup = false;
+    for (std::uint32_t i = 0; i < header.symbolCount; ++i) {
+        remap[i] = Symbols::intern(symbolData.substr(symbolOffsets[i], symbolOffsets[i + 1] - symbolOffsets[i]));
+        fixup = fixup || remap[i] != i;
+    }
+
+    if (fixup) {
+        ast.ownedNodes.assign(ast.nodes.begin(), ast.nodes.end());
+        ast.ownedLists.assign(ast.lists.begin(), ast.lists.end());
+        auto remapList = [&](std::uint32_t start) {
+            auto count = ast.ownedLists[start];
+            for (std::uint32_t i = 1; i <= count; ++i) {
+                ast.ownedLists[start + i] = remap[ast.ownedLists[start + i]];
+            }
+        };
+        for (auto& node : ast.ownedNodes) {
+            switch (node.kind) {
+                case AST::NodeType::Identifier:
+                case AST::NodeType::VarDeclare:
+                case AST::NodeType::Property: {
+                    node.a = remap[node.a];
+                    break;
+                }
+                case AST::NodeType::FunctionDeclaration: {
+                    node.a = remap[node.a];
+                    remapList(node.b + 2); // skips the name slot and parameter count
+                    break;
+                }
+                case AST::NodeType::Program: {
+                    remapList(node.b);
+                    break;
+                }
+                default: break;
+            }
+        }
+        ast.nodes = ast.ownedNodes;
+        ast.lists = ast.ownedLists;
+    }
+
+    ast.backing = std::move(file);
+    return ast;
+}
+
+bool ScriptCache::store(const std::string& cachePath, const FlatAST& ast, std::string_view source) {
+    std::vector<std::uint32_t> symbolOffsets{0};
+    std::string symbolData;
+    for (SymbolId id = 0; id < Symbols::count(); ++id) {
+        symbolData += Symbols::name(id);
+        symbolOffsets.push_back(static_cast<std::uint32_t>(symbolData.size()));
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.nodeSize = sizeof(FlatAST::Node);
+    header.endianCheck = ENDIAN_CHECK;
+    header.sourceHash = utils::hashBytes(source);
+    header.sourceSize = source.size();
+    header.nodeCount = static_cast<std::uint32_t>(ast.nodes.size());
+    header.listCount = static_cast<std::uint32_t>(ast.lists.size());
+    header.stringCount = static_cast<std::uint32_t>(ast.stringOffsets.size());
+    header.symbolCount = static_cast<std::uint32_t>(symbolOffsets.size() - 1);
+    header.stringBytes = ast.stringData.size();
+    header.symbolBytes = symbolData.size();
+
+    std::string payload;
+    writePadded(payload, ast.nodes.data(), ast.nodes.size_bytes());
+    writePadded(payload, ast.lists.data(), ast.lists.size_bytes());
+    writePadded(payload, ast.stringOffsets.data(), ast.stringOffsets.size_bytes());
+    writePadded(payload, ast.stringData.data(), ast.stringData.size());
+    writePadded(payload, symbolOffsets.data(), symbolOffsets.size() * sizeof(std::uint32_t));
+    payload += symbolData;
+    header.payloadHash = utils::hashBytes(payload);
+
+    // written to a temporary name and renamed over, so a process starting at the same time never sees half a file.
+    std::string tempPath = cachePath + ".tmp" + std::to_string(std::random_device()());
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+
+        std::string head;
+        writePadded(head, &header, sizeof(header));
+        out.write(head.data(), head.size());
+        out.write(payload.data(), payload.size());
+
+        if (!out.good()) {
+            out.close();
+            std::error_code ignored;
+            std::filesystem::remove(tempPath, ignored);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
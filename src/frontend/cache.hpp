@@ -0,0 +1,23 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include "flat_ast.hpp"
+
+namespace frontend {
+    // .yhsc files are a FlatAST written out as is, plus the symbol names it uses, a hash of the source
+    // it was made from and one of the file's own contents. loading one maps the file and points the
+    // FlatAST straight into it, symbol ids only get rewritten if this process interned things in a
+    // different order.
+    class ScriptCache {
+    public:
+        ScriptCache() = delete;
+
+        // script.yhs -> script.yhsc, right next to the source.
+        static std::string pathFor(const std::string& sourcePath);
+
+        // nullopt if theres no cache file or it's stale, from another version, or broken.
+        static std::optional<FlatAST> load(const std::string& cachePath, std::string_view source);
+        static bool store(const std::string& cachePath, const FlatAST& ast, std::string_view source);
+    };
+}
\ No newline at end of file
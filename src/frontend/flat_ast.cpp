@@ -0,0 +1,356 @@
+#include "flat_ast.hpp"
+#include <stdexcept>
+
+using namespace frontend;
+
+namespace frontend {
+    class Flattener {
+    public:
+        FlatAST out;
+        std::uint32_t memberSites = 0;
+
+        FlatAST::Index emit(AST::Stmt* stmt) {
+            FlatAST::Node node{stmt->kind, 0, 0, 0, 0, 0};
+
+            switch (stmt->kind) {
+                case AST::NodeType::NumericLiteral: {
+                    node.a = static_cast<std::uint32_t>(static_cast<AST::NumericLiteral*>(stmt)->value);
+                    break;
+                }
+                case AST::NodeType::Identifier: {
+                    auto ident = static_cast<AST::Identifier*>(stmt);
+                    node.a = ident->symbol;
+                    node.b = ident->depth;
+                    node.c = ident->slot;
+                    break;
+                }
+                case AST::NodeType::BinaryExpr: {
+                    auto binop = static_cast<AST::BinEx*>(stmt);
+                    node.a = emit(binop->left);
+                    node.b = emit(binop->right);
+                    node.op = static_cast<std::uint8_t>(binop->op);
+                    break;
+                }
+                case AST::NodeType::CompExpr: {
+                    auto compEx = static_cast<AST::CompEx*>(stmt);
+                    node.a = emit(compEx->left);
+                    node.b = emit(compEx->right);
+                    node.op = static_cast<std::uint8_t>(compEx->op);
+                    break;
+                }
+                case AST::NodeType::VarDeclare: {
+                    auto declaration = static_cast<AST::VarDeclare*>(stmt);
+                    node.a = declaration->identifier;
+                    node.b = declaration->value ? emit(declaration->value.value()) : FlatAST::NONE;
+                    node.c = declaration->slot;
+                    node.op = declaration->constant;
+                    break;
+                }
+                case AST::NodeType::AssignmentExpr: {
+                    auto assign = static_cast<AST::AssignExpr*>(stmt);
+                    node.a = emit(assign->assigne);
+                    node.b = emit(assign->value);
+                    break;
+                }
+                case AST::NodeType::Property: {
+                    auto property = static_cast<AST::Property*>(stmt);
+                    node.a = property->key;
+                    node.b = property->value && property->value.value() ? emit(property->value.value()) : FlatAST::NONE;
+                    break;
+                }
+                case AST::NodeType::ObjectLiteral: {
+                    node.a = emitList(static_cast<AST::ObjectLiteral*>(stmt)->properties);
+                    break;
+                }
+                case AST::NodeType::MemberExpr: {
+                    auto member = static_cast<AST::MemberExpr*>(stmt);
+                    node.a = emit(member->object);
+                    node.b = emit(member->property);
+                    node.c = memberSites++;
+                    break;
+                }
+                case AST::NodeType::CallExpr: {
+                    auto call = static_cast<AST::CallExpr*>(stmt);
+                    node.a = emit(call->caller);
+                    node.b = emitList(call->args);
+                    node.op = call->tail;
+                    break;
+                }
+                case AST::NodeType::FunctionDeclaration: {
+                    auto declaration = static_cast<AST::FunDeclare*>(stmt);
+                    node.a = declaration->name;
+                    node.op = declaration->captured;
+                    node.c = emitList(declaration->body);
+                    node.b = static_cast<std::uint32_t>(out.ownedLists.size());
+                    out.ownedLists.push_back(declaration->slot);
+                    out.ownedLists.push_back(declaration->parameters.count);
+                    emitSymbols(declaration->locals);
+                    break;
+                }
+                case AST::NodeType::If: {
+                    auto ifstmt = static_cast<AST::IfStmt*>(stmt);
+                    node.a = emit(ifstmt->condition);
+                    node.b = emitList(ifstmt->body);
+                    node.c = ifstmt->elseStmt ? emitList(ifstmt->elseStmt.value()->body) : FlatAST::NONE;
+                    break;
+                }
+                case AST::NodeType::StringLiteral: {
+                    auto& value = static_cast<AST::StringLiteral*>(stmt)->value;
+                    node.a = static_cast<std::uint32_t>(out.ownedStringOffsets.size() - 1);
+                    out.ownedStringData.insert(out.ownedStringData.end(), value.begin(), value.end());
+                    out.ownedStringOffsets.push_back(static_cast<std::uint32_t>(out.ownedStringData.size()));
+                    break;
+                }
+                case AST::NodeType::While: {
+                    auto whilestmt = static_cast<AST::WhileStmt*>(stmt);
+                    node.a = emit(whilestmt->condition);
+                    node.b = emitList(whilestmt->body);
+                    break;
+                }
+                case AST::NodeType::BreakStmt:
+                case AST::NodeType::ContinueStmt: {
+                    break;
+                }
+                case AST::NodeType::ReturnStmt: {
+                    auto returnstmt = static_cast<AST::ReturnStmt*>(stmt);
+                    node.a = returnstmt->value ? emit(returnstmt->value.value()) : FlatAST::NONE;
+                    break;
+                }
+                case AST::NodeType::Program: {
+                    auto program = static_cast<AST::Program*>(stmt);
+                    node.a = emitList(program->body);
+                    node.b = emitSymbols(program->globals);
+                    node.c = memberSites;
+                    break;
+                }
+                default: {
+                    throw std::runtime_error("FlatAST: node type can't be flattened.");
+                }
+            }
+
+            out.ownedNodes.push_back(node);
+            return static_cast<FlatAST::Index>(out.ownedNodes.size() - 1);
+        }
+
+        std::uint32_t emitSymbols(const AST::List<SymbolId>& symbols) {
+            auto start = static_cast<std::uint32_t>(out.ownedLists.size());
+            out.ownedLists.push_back(symbols.count);
+            out.ownedLists.insert(out.ownedLists.end(), symbols.begin(), symbols.end());
+            return start;
+        }
+
+        // children get emitted first, then the list itself, so the list never gets split up by them.
+        template <typename T>
+        std::uint32_t emitList(const AST::List<T>& items) {
+            std::vector<FlatAST::Index> indices;
+            indices.reserve(items.size());
+            for (auto& item : items) {
+                indices.push_back(emit(item));
+            }
+
+            auto start = static_cast<std::uint32_t>(out.ownedLists.size());
+            out.ownedLists.push_back(static_cast<std::uint32_t>(indices.size()));
+            out.ownedLists.insert(out.ownedLists.end(), indices.begin(), indices.end());
+            return start;
+        }
+    };
+}
+
+void FlatAST::useOwned() {
+    nodes = ownedNodes;
+    lists = ownedLists;
+    stringOffsets = ownedStringOffsets;
+    stringData = std::string_view(ownedStringData.data(), ownedStringData.size());
+}
+
+FlatAST FlatAST::fromProgram(AST::Program* program) {
+    Flattener flattener;
+    std::size_t total = 0;
+    for (auto count : program->nodeCounts) total += count;
+    flattener.out.ownedNodes.reserve(total + 1);
+    flattener.out.ownedStringOffsets.push_back(0);
+
+    flattener.emit(program);
+    flattener.out.useOwned();
+    return std::move(flattener.out);
+}
+
+namespace {
+    class Unflattener {
+    public:
+        const FlatAST& ast;
+        AST::Program* program;
+
+        template <typename T>
+        T* make() {
+            auto node = program->arena->make<T>();
+            program->nodeCounts[static_cast<std::size_t>(node->kind)]++;
+            return node;
+        }
+
+        template <typename T>
+        AST::List<T> copyList(const AST::List<T>& items) {
+            AST::List<T> result;
+            result.count = items.count;
+            if (items.count > 0) {
+                result.items = static_cast<T*>(program->arena->allocate(sizeof(T) * items.count, alignof(T)));
+                std::copy(items.begin(), items.end(), result.items);
+            }
+            return result;
+        }
+
+        template <typename T>
+        AST::List<T*> buildList(std::uint32_t start) {
+            auto indices = ast.list(start);
+            AST::List<T*> result;
+            result.count = indices.count;
+            if (indices.count > 0) {
+                result.items = static_cast<T**>(program->arena->allocate(sizeof(T*) * indices.count, alignof(T*)));
+                for (std::uint32_t i = 0; i < indices.count; ++i) {
+                    result.items[i] = static_cast<T*>(build(indices[i]));
+                }
+            }
+            return result;
+        }
+
+        AST::Stmt* build(FlatAST::Index index) {
+            const FlatAST::Node& node = ast.nodes[index];
+
+            switch (node.kind) {
+                case AST::NodeType::NumericLiteral: {
+                    auto num = make<AST::NumericLiteral>();
+                    num->value = static_cast<int>(node.a);
+                    return num;
+                }
+                case AST::NodeType::Identifier: {
+                    auto ident = make<AST::Identifier>();
+                    ident->symbol = node.a;
+                    ident->depth = node.b;
+                    ident->slot = node.c;
+                    return ident;
+                }
+                case AST::NodeType::BinaryExpr: {
+                    auto binop = make<AST::BinEx>();
+                    binop->left = static_cast<AST::Expr*>(build(node.a));
+                    binop->right = static_cast<AST::Expr*>(build(node.b));
+                    binop->op = static_cast<AST::BinaryOp>(node.op);
+                    return binop;
+                }
+                case AST::NodeType::CompExpr: {
+                    auto compEx = make<AST::CompEx>();
+                    compEx->left = static_cast<AST::Expr*>(build(node.a));
+                    compEx->right = static_cast<AST::Expr*>(build(node.b));
+                    compEx->op = static_cast<AST::CompareOp>(node.op);
+                    return compEx;
+                }
+                case AST::NodeType::VarDeclare: {
+                    auto declaration = make<AST::VarDeclare>();
+                    declaration->identifier = node.a;
+                    declaration->slot = node.c;
+                    declaration->constant = node.op != 0;
+                    if (node.b != FlatAST::NONE) {
+                        declaration->value = static_cast<AST::Expr*>(build(node.b));
+                    }
+                    return declaration;
+                }
+                case AST::NodeType::AssignmentExpr: {
+                    auto assign = make<AST::AssignExpr>();
+                    assign->assigne = static_cast<AST::Expr*>(build(node.a));
+                    assign->value = static_cast<AST::Expr*>(build(node.b));
+                    return assign;
+                }
+                case AST::NodeType::Property: {
+                    auto property = make<AST::Property>();
+                    property->key = node.a;
+                    if (node.b != FlatAST::NONE) {
+                        property->value = static_cast<AST::Expr*>(build(node.b));
+                    }
+                    return property;
+                }
+                case AST::NodeType::ObjectLiteral: {
+                    auto object = make<AST::ObjectLiteral>();
+                    object->properties = buildList<AST::Property>(node.a);
+                    return object;
+                }
+                case AST::NodeType::MemberExpr: {
+                    auto member = make<AST::MemberExpr>();
+                    member->object = static_cast<AST::Expr*>(build(node.a));
+                    member->property = static_cast<AST::Expr*>(build(node.b));
+                    return member;
+                }
+                case AST::NodeType::CallExpr: {
+                    auto call = make<AST::CallExpr>();
+                    call->caller = static_cast<AST::Expr*>(build(node.a));
+                    call->args = buildList<AST::Expr>(node.b);
+                    call->tail = node.op != 0;
+                    return call;
+                }
+                case AST::NodeType::FunctionDeclaration: {
+                    auto fn = make<AST::FunDeclare>();
+                    fn->name = node.a;
+                    auto scope = ast.scope(index);
+                    fn->slot = scope.nameSlot;
+                    fn->parameters = copyList(scope.params);
+                    fn->locals = copyList(scope.locals);
+                    fn->body = buildList<AST::Stmt>(node.c);
+                    fn->captured = node.op != 0;
+                    return fn;
+                }
+                case AST::NodeType::If: {
+                    auto ifstmt = make<AST::IfStmt>();
+                    ifstmt->condition = static_cast<AST::Expr*>(build(node.a));
+                    ifstmt->multiline = true;
+                    ifstmt->body = buildList<AST::Stmt>(node.b);
+                    if (node.c != FlatAST::NONE) {
+                        auto elsestmt = make<AST::ElseStmt>();
+                        elsestmt->multiline = true;
+                        elsestmt->body = buildList<AST::Stmt>(node.c);
+                        ifstmt->elseStmt = elsestmt;
+                    }
+                    return ifstmt;
+                }
+                case AST::NodeType::StringLiteral: {
+                    auto string = make<AST::StringLiteral>();
+                    string->value = ast.string(node.a);
+                    return string;
+                }
+                case AST::NodeType::While: {
+                    auto whilestmt = make<AST::WhileStmt>();
+                    whilestmt->condition = static_cast<AST::Expr*>(build(node.a));
+                    whilestmt->multiline = true;
+                    whilestmt->body = buildList<AST::Stmt>(node.b);
+                    return whilestmt;
+                }
+                case AST::NodeType::BreakStmt: {
+                    return make<AST::BreakStmt>();
+                }
+                case AST::NodeType::ContinueStmt: {
+                    return make<AST::ContinueStmt>();
+                }
+                case AST::NodeType::ReturnStmt: {
+                    auto returnstmt = make<AST::ReturnStmt>();
+                    if (node.a != FlatAST::NONE) {
+                        returnstmt->value = static_cast<AST::Expr*>(build(node.a));
+                    }
+                    return returnstmt;
+                }
+                default: {
+                    throw std::runtime_error("FlatAST: node can't be rebuilt.");
+                }
+            }
+        }
+    };
+}
+
+std::unique_ptr<AST::Program> FlatAST::toProgram() const {
+    auto program = std::make_unique<AST::Program>();
+    const Node& root = nodes[this->root()];
+    if (root.kind != AST::NodeType::Program) {
+        throw std::runtime_error("FlatAST: root isn't a program.");
+    }
+
+    Unflattener unflattener{*this, program.get()};
+    program->body = unflattener.buildList<AST::Stmt>(root.a);
+    program->globals = unflattener.copyList(list(root.b));
+    return program;
+}
\ No newline at end of file
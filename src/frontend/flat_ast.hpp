@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.hpp"
+#include "../utils.hpp"
+
+namespace frontend {
+    // the whole program as one array of fixed size records in post-order (children always come before
+    // their parent, the root is the last node). children are 32 bit indices instead of Stmt pointers.
+    // theres no pointers in it at all, so it's also what gets written to .yhsc cache files.
+    class FlatAST {
+    public:
+        using Index = std::uint32_t;
+        static constexpr Index NONE = 0xFFFFFFFF;
+
+        // what a, b and c hold depends on kind:
+        //   NumericLiteral      a = value
+        //   Identifier          a = symbol, b = depth, c = slot (from the resolver)
+        //   BinaryExpr          a = left, b = right, op = BinaryOp
+        //   CompExpr            a = left, b = right, op = CompareOp
+        //   VarDeclare          a = symbol, b = value (or NONE), c = slot, op = constant
+        //   AssignmentExpr      a = assignee, b = value
+        //   Property            a = key symbol, b = value (or NONE)
+        //   ObjectLiteral       a = property list
+        //   MemberExpr          a = object, b = property, c = site (which inline cache it uses)
+        //   CallExpr            a = caller, b = argument list, op = tail call
+        //   FunctionDeclaration a = name symbol, b = scope (see scope()), c = body list, op = captured
+        //   If                  a = condition, b = body list, c = else body list (or NONE), the else is folded in
+        //   StringLiteral       a = string index
+        //   While               a = condition, b = body list
+        //   ReturnStmt          a = value (or NONE)
+        //   Program             a = body list, b = global slot names, c = member site count
+        struct Node {
+            AST::NodeType kind;
+            std::uint8_t op;
+            std::uint16_t flags; // spare, kept at 0 so cache files come out the same every time
+            std::uint32_t a;
+            std::uint32_t b;
+            std::uint32_t c;
+        };
+        static_assert(sizeof(Node) == 16);
+
+        // these either point into the owned vectors below or straight into a mapped cache file.
+        std::span<const Node> nodes;
+        // lists are stored as a count followed by the items, nodes refer to them by the position of the count.
+        std::span<const std::uint32_t> lists;
+
+        FlatAST() {}
+        FlatAST(FlatAST&&) = default;
+        FlatAST& operator=(FlatAST&&) = default;
+        FlatAST(const FlatAST&) = delete;
+        FlatAST& operator=(const FlatAST&) = delete;
+
+        Index root() const {
+            return static_cast<Index>(nodes.size() - 1);
+        }
+
+        AST::List<std::uint32_t> list(Index start) const {
+            AST::List<std::uint32_t> result;
+            result.count = lists[start];
+            result.items = const_cast<std::uint32_t*>(lists.data() + start + 1);
+            return result;
+        }
+
+        // a function's scope is stored as name slot, parameter count, then a list of the slot names.
+        struct Scope {
+            std::uint32_t nameSlot;
+            AST::List<SymbolId> params; // the first slots
+            AST::List<SymbolId> locals;
+        };
+        Scope scope(Index function) const {
+            auto start = nodes[function].b;
+            Scope result{lists[start], {}, list(start + 2)};
+            result.params.items = result.locals.items;
+            result.params.count = lists[start + 1];
+            return result;
+        }
+
+        std::string_view string(std::uint32_t index) const {
+            return stringData.substr(stringOffsets[index], stringOffsets[index + 1] - stringOffsets[index]);
+        }
+
+        static FlatAST fromProgram(AST::Program* program);
+        // rebuilds the pointer AST, for running a cached script on an engine that wants one.
+        std::unique_ptr<AST::Program> toProgram() const;
+    private:
+        friend class ScriptCache;
+        friend class Flattener;
+
+        // string literals are one blob, string i is [offsets[i], offsets[i + 1]).
+        std::span<const std::uint32_t> stringOffsets;
+        std::string_view stringData;
+
+        std::vector<Node> ownedNodes;
+        std::vector<std::uint32_t> ownedLists;
+        std::vector<std::uint32_t> ownedStringOffsets;
+        std::vector<char> ownedStringData;
+        // the cache file the spans point into, if they do.
+        std::unique_ptr<utils::File> backing;
+
+        // points the spans at the owned storage.
+        void useOwned();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "lexer.hpp"
+
+// reserved words, looked up through a perfect hash that gets built at compile time.
+namespace frontend {
+    namespace keywords {
+        struct Keyword {
+            std::string_view text;
+            Lexer::TokenType type;
+        };
+
+        // adding a keyword is just adding it here, the table below gets rebuilt from this.
+        inline constexpr Keyword LIST[] = {
+            {"var", Lexer::TokenType::Var},
+            {"const", Lexer::TokenType::Const},
+            {"fun", Lexer::TokenType::Fun},
+            {"if", Lexer::TokenType::If},
+            {"else", Lexer::TokenType::Else},
+            {"while", Lexer::TokenType::While},
+            {"break", Lexer::TokenType::Break},
+            {"continue", Lexer::TokenType::Continue},
+            {"return", Lexer::TokenType::Return}
+        };
+
+        inline constexpr std::size_t COUNT = std::size(LIST);
+
+        constexpr std::size_t tableSize() {
+            std::size_t size = 1;
+            while (size < COUNT * 2) size <<= 1;
+            return size;
+        }
+
+        inline constexpr std::size_t TABLE_SIZE = tableSize();
+
+        // only looks at the length and a few characters, the table build makes sure thats enough.
+        constexpr std::uint32_t hash(std::string_view word, std::uint32_t seed) {
+            std::uint32_t h = seed ^ static_cast<std::uint32_t>(word.size());
+            h = (h ^ static_cast<std::uint8_t>(word[0])) * 0x01000193u;
+            h = (h ^ static_cast<std::uint8_t>(word[word.size() - 1])) * 0x01000193u;
+            if (word.size() > 1) h = (h ^ static_cast<std::uint8_t>(word[1])) * 0x01000193u;
+            return h ^ (h >> 15);
+        }
+
+        struct Table {
+            std::uint32_t seed = 0;
+            std::size_t minLength = 0;
+            std::size_t maxLength = 0;
+            std::array<std::int8_t, TABLE_SIZE> slots{};
+            bool found = false;
+        };
+
+        // tries seeds until every keyword lands in its own slot.
+        constexpr Table buildTable() {
+            Table table;
+            table.minLength = LIST[0].text.size();
+            for (auto& keyword : LIST) {
+                table.minLength = std::min(table.minLength, keyword.text.size());
+                table.maxLength = std::max(table.maxLength, keyword.text.size());
+            }
+
+            for (std::uint32_t seed = 0; seed < 10000; ++seed) {
+                table.slots.fill(-1);
+                bool collided = false;
+                for (std::size_t i = 0; i < COUNT && !collided; ++i) {
+                    auto& slot = table.slots[hash(LIST[i].text, seed) & (TABLE_SIZE - 1)];
+                    collided = slot != -1;
+                    slot = static_cast<std::int8_t>(i);
+                }
+                if (!collided) {
+                    table.seed = seed;
+                    table.found = true;
+                    return table;
+                }
+            }
+            return table;
+        }
+
+        inline constexpr Table TABLE = buildTable();
+        static_assert(TABLE.found, "No perfect hash seed found for the keyword list, tweak keywords::hash.");
+
+        constexpr std::optional<Lexer::TokenType> find(std::string_view word) {
+            if (word.size() < TABLE.minLength || word.size() > TABLE.maxLength) return std::nullopt;
+
+            auto index = TABLE.slots[hash(word, TABLE.seed) & (TABLE_SIZE - 1)];
+            if (index < 0 || LIST[index].text != word) return std::nullopt;
+            return LIST[index].type;
+        }
+
+        static_assert(find("while") == Lexer::TokenType::While);
+        static_assert(!find("whale").has_value());
+    }
+}
\ No newline at end of file
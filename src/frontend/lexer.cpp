@@ -1,188 +1,184 @@
 #include "lexer.hpp"
+#include "scan.hpp"
+#include "keywords.hpp"
 
 using namespace frontend;
 
-std::deque<Lexer::Token*> Lexer::tokenize(const std::string& sourceCode) {
-    std::deque<Token*> tokens;
-    std::deque<std::string> src;
+Lexer::TokenStream Lexer::tokenize(std::string_view sourceCode) {
+    TokenStream stream;
+    stream.source = sourceCode;
+    // most tokens are a few characters long, this saves a bunch of regrowing on big files.
+    stream.tokens.reserve(sourceCode.size() / 4 + 1);
+
+    auto& tokens = stream.tokens;
+    const char* src = sourceCode.data();
+    const std::size_t size = sourceCode.size();
+    const char* end = src + size;
+    std::size_t pos = 0;
+    int line = 1;
+    auto& scanner = scan::kernels();
 
-    std::transform(sourceCode.begin(), sourceCode.end(), std::back_inserter(src),
-                    [](char ch) { return std::string(1, ch); });
+    // runs the kernel from the cursor and moves the cursor to wherever it stopped.
+    auto advance = [&](scan::ScanFn kernel) {
+        pos = kernel(src + pos, end, line) - src;
+    };
 
-    auto skipComments = [&src]() {
-        while (!src.empty()) {
-            if (src.size() >= 2 && src[0] == "/" && src[1] == "/") {
-                while (!src.empty() && src[0] != "\n") {
-                    src.pop_front();
-                }
-                if (!src.empty()) {
-                    src.pop_front();
-                }
-            } else if (src.size() >= 2 && src[0] == "/" && src[1] == "*") {
-                src.pop_front();
-                src.pop_front();
-                while (src.size() >= 2 && !(src[0] == "*" && src[1] == "/")) {
-                    src.pop_front();
-                }
-                if (src.size() >= 2) {
-                    src.pop_front();
-                    src.pop_front();
-                }
+    auto peek = [&](std::size_t ahead) -> char {
+        return pos + ahead < size ? src[pos + ahead] : '\0';
+    };
+
+    auto push = [&](TokenType type, std::size_t start, std::size_t length) {
+        tokens.emplace_back(type, static_cast<std::uint32_t>(start), static_cast<std::uint32_t>(length), line);
+    };
+
+    // also eats the whitespace around the comments, so the main loop never sees any.
+    auto skipComments = [&]() {
+        advance(scanner.skipWhitespace);
+        while (pos + 1 < size && src[pos] == '/') {
+            if (src[pos + 1] == '/') {
+                advance(scanner.findLineEnd);
+            } else if (src[pos + 1] == '*') {
+                pos += 2;
+                advance(scanner.findCommentEnd);
+                pos = pos < size ? pos + 2 : size;
             } else {
                 break;
             }
+            advance(scanner.skipWhitespace);
         }
     };
 
     // we are parsing strings within the lexer, but then later storing it in the AST.
 
-    auto handleEscapeSequence = [&src]() -> std::string {
-        src.pop_front();
-        if (src.empty()) return "";
+    auto handleEscapeSequence = [&](std::string& out) {
+        pos++;
+        if (pos >= size) return;
 
-        char escapedChar = src.front()[0];
-        src.pop_front();
+        char escapedChar = src[pos++];
 
         switch (escapedChar) {
-            case 'n': return "\n";
-            case 't': return "\t";
-            case '\"': return "\"";
-            case '\\': return "\\";
-            case '\'': return "\'";
-            case 'b': return "\b";
-            case 'f': return "\f";
-            case 'r': return "\r";
-            case 'v': return "\v";
-            case 'a': return "\a";
-            case '0': return "\0";
-
-            default: return std::string(1, escapedChar);
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case '\"': out += '\"'; break;
+            case '\\': out += '\\'; break;
+            case '\'': out += '\''; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'r': out += '\r'; break;
+            case 'v': out += '\v'; break;
+            case 'a': out += '\a'; break;
+            case '0': out += '\0'; break;
+
+            default: out += escapedChar; break;
         }
     };
 
-    auto parseStringLiteral = [&src, &handleEscapeSequence]() -> std::string {
-        std::string strLiteral;
-        src.pop_front();
+    // strings without escapes are just a view into the source, only the ones with escapes get copied.
+    auto parseStringLiteral = [&]() {
+        int startLine = line;
+        pos++;
+        std::size_t start = pos;
+
+        advance(scanner.findStringStop);
 
-        while (!src.empty() && src[0] != "\"") {
-            if (src[0] == "\\") {
-                strLiteral += handleEscapeSequence();
+        if (pos < size && src[pos] == '\"') {
+            tokens.emplace_back(TokenType::String, static_cast<std::uint32_t>(start), static_cast<std::uint32_t>(pos - start), startLine);
+            pos++;
+            return;
+        }
+
+        std::string strLiteral(src + start, pos - start);
+        while (pos < size && src[pos] != '\"') {
+            if (src[pos] == '\\') {
+                handleEscapeSequence(strLiteral);
             } else {
-                strLiteral += src[0];
-                src.pop_front();
+                std::size_t chunk = pos;
+                advance(scanner.findStringStop);
+                strLiteral.append(src + chunk, pos - chunk);
             }
         }
 
-        if (!src.empty() && src[0] == "\"") {
-            src.pop_front();
-        } else {
+        if (pos >= size) {
             throw std::invalid_argument("Lexer: Unterminated string literal.");
         }
+        pos++;
 
-        return strLiteral;
+        auto index = static_cast<std::uint32_t>(stream.strings.size());
+        stream.strings.push_back(std::move(strLiteral));
+        tokens.emplace_back(TokenType::String, index, 0, startLine, true);
     };
 
-    int line = 1;
-
-    while (src.size() > 0) {
+    while (pos < size) {
         skipComments();
 
-        if (src.empty()) break;
+        if (pos >= size) break;
 
-        if (src[0] == "\"") {
-            tokens.push_back(token(parseStringLiteral(), line, TokenType::String));
-        }
-        
-        if (src[0] == "(") {
-            tokens.push_back(token(src.front(), line, TokenType::OpenParen));
-            src.pop_front();
-        } else if (src[0] == ")") {
-            tokens.push_back(token(src.front(), line, TokenType::CloseParen));
-            src.pop_front();
-        }
-        
-        else if (src[0] == "{") {
-            tokens.push_back(token(src.front(), line, TokenType::OpenBrace));
-            src.pop_front();
-        } else if (src[0] == "}") {
-            tokens.push_back(token(src.front(), line, TokenType::CloseBrace));
-            src.pop_front();
-        }
+        char ch = src[pos];
 
-        else if (src[0] == "[") {
-            tokens.push_back(token(src.front(), line, TokenType::OpenBrack));
-            src.pop_front();
-        } else if (src[0] == "]") {
-            tokens.push_back(token(src.front(), line, TokenType::OpenBrack));
-            src.pop_front();
-        }
+        switch (ch) {
+            case '\"': parseStringLiteral(); break;
 
-        else if (src[0] == "+" || src[0] == "-" || src[0] == "*" || src[0] == "/" || src[0] == "%") {
-            tokens.push_back(token(src.front(), line, TokenType::BinOp));
-            src.pop_front();
-        } else if (src[0] == "=") {
-            if (src[1] == "=") {
-                tokens.push_back(token(src[0] + src[1], line, TokenType::ComparisonOp));
-                src.pop_front();
-                src.pop_front();
-            } else {
-                tokens.push_back(token(src.front(), line, TokenType::Equals));
-                src.pop_front();
-            }
-        } else if (src[0] == ";") {
-            tokens.push_back(token(src.front(), line, TokenType::Semicolon));
-            src.pop_front();
-        } else if (src[0] == ",") {
-            tokens.push_back(token(src.front(), line, TokenType::Comma));
-            src.pop_front();
-        } else if (src[0] == ":") {
-            tokens.push_back(token(src.front(), line, TokenType::Colon));
-            src.pop_front();
-        } else if (src[0] == ".") {
-            tokens.push_back(token(src.front(), line, TokenType::Dot));
-            src.pop_front();
-        } else if (src[0] == ">" || src[0] == "<") {
-            if (src[1] == "=") {
-                tokens.push_back(token(src[0] + src[1], line, TokenType::ComparisonOp));
-                src.pop_front();
-                src.pop_front();
-            } else {
-                tokens.push_back(token(src[0], line, TokenType::ComparisonOp));
-                src.pop_front();
-            }
-        } else {
-            if (utils::isInt(src[0])) {
-                std::string num;
-                while (src.size() > 0 && utils::isInt(src[0])) {
-                    num += src.front();
-                    src.pop_front();
+            case '(': push(TokenType::OpenParen, pos++, 1); break;
+            case ')': push(TokenType::CloseParen, pos++, 1); break;
+
+            case '{': push(TokenType::OpenBrace, pos++, 1); break;
+            case '}': push(TokenType::CloseBrace, pos++, 1); break;
+
+            case '[': push(TokenType::OpenBrack, pos++, 1); break;
+            case ']': push(TokenType::CloseBrack, pos++, 1); break;
+
+            case '+': case '-': case '*': case '/': case '%':
+                push(TokenType::BinOp, pos++, 1);
+                break;
+
+            case '=':
+                if (peek(1) == '=') {
+                    push(TokenType::ComparisonOp, pos, 2);
+                    pos += 2;
+                } else {
+                    push(TokenType::Equals, pos++, 1);
                 }
+                break;
 
-                tokens.push_back(token(num, line, TokenType::Int));
-            } else if (utils::isAlpha(src[0])) {
-                std::string ident;
-                while (src.size() > 0 && utils::isAlpha(src[0])) {
-                    ident += src.front();
-                    src.pop_front();
+            case ';': push(TokenType::Semicolon, pos++, 1); break;
+            case ',': push(TokenType::Comma, pos++, 1); break;
+            case ':': push(TokenType::Colon, pos++, 1); break;
+            case '.': push(TokenType::Dot, pos++, 1); break;
+
+            case '>': case '<':
+                if (peek(1) == '=') {
+                    push(TokenType::ComparisonOp, pos, 2);
+                    pos += 2;
+                } else {
+                    push(TokenType::ComparisonOp, pos++, 1);
                 }
-                if (RESERVED.find(ident) == RESERVED.end()) {
-                    tokens.push_back(token(ident, line, TokenType::Identifier));
+                break;
+
+            default: {
+                if (utils::isInt(ch)) {
+                    std::size_t start = pos;
+                    advance(scanner.scanDigits);
+
+                    push(TokenType::Int, start, pos - start);
+                } else if (utils::isAlpha(ch)) {
+                    std::size_t start = pos;
+                    advance(scanner.scanIdentifier);
+                    auto word = sourceCode.substr(start, pos - start);
+                    if (auto keyword = keywords::find(word)) {
+                        push(*keyword, start, pos - start);
+                    } else {
+                        push(TokenType::Identifier, start, pos - start);
+                        tokens.back().symbol = Symbols::intern(word);
+                    }
                 } else {
-                    tokens.push_back(token(ident, line, RESERVED[ident]));
+                    std::cout << "Lexer: unrecognized token found: " << ch;
+                    exit(1);
                 }
-            } else if (src[0] == "\n") {
-                line += 1;
-                src.pop_front();
-            } else if (utils::isSkippable(src[0])) {
-                src.pop_front();
-            } else {
-                std::cout << "Lexer: unrecognized token found: " << src[0];
-                exit(1);
             }
         }
     }
 
-    tokens.push_back(token("EOF", line, Lexer::TokenType::EOF_));
-    
-    return tokens;
+    tokens.emplace_back(TokenType::EOF_, static_cast<std::uint32_t>(size), 0, line);
+
+    return stream;
 }
\ No newline at end of file
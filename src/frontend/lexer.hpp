@@ -1,10 +1,12 @@
 #pragma once
 #include <string>
-#include <deque>
+#include <string_view>
+#include <vector>
+#include <cstdint>
 #include <algorithm>
 #include <iostream>
 #include "../utils.hpp"
-#include <unordered_map>
+#include "symbols.hpp"
 
 
 namespace frontend {
@@ -12,7 +14,7 @@ namespace frontend {
     public:
         Lexer() {}
 
-        enum class TokenType {
+        enum class TokenType : std::uint8_t {
             Int, // 0
             Identifier, // 1
             Equals, // 2
@@ -36,31 +38,37 @@ namespace frontend {
             String, // 20
             While, // 21
             Break, // 22
-            Null, // 23
-            EOF_, // 24
+            Continue, // 23
+            Return, // 24
+            Null, // 25
+            EOF_, // 26
         };
+
+        // tokens dont own their text, they point back into the source (or into TokenStream::strings
+        // for string literals that had escape sequences in them). identifiers also carry their interned symbol.
         struct Token {
-            std::string value;
             TokenType type;
+            bool owned;
+            std::uint32_t offset;
+            std::uint32_t length;
             int position;
-            Token(std::string value, TokenType type, int position) : value(value), type(type), position(position) {}
-
+            SymbolId symbol = 0;
+            Token(TokenType type, std::uint32_t offset, std::uint32_t length, int position, bool owned = false) : type(type), owned(owned), offset(offset), length(length), position(position) {}
         };
 
-        std::deque<Token*> tokenize(const std::string& sourceCode);
-    private:
-        Token* token(std::string value, int position, TokenType type) {
-            return new Token(value, type, position);
-        }
+        // the source has to outlive the stream, since the tokens are just views into it.
+        struct TokenStream {
+            std::string_view source;
+            std::vector<Token> tokens;
+            std::vector<std::string> strings;
 
-        std::unordered_map<std::string, Lexer::TokenType> RESERVED = {
-            {"var", Lexer::TokenType::Var},
-            {"const", Lexer::TokenType::Const},
-            {"fun", Lexer::TokenType::Fun},
-            {"if", Lexer::TokenType::If},
-            {"else", Lexer::TokenType::Else},
-            {"while", Lexer::TokenType::While},
-            {"break", Lexer::TokenType::Break}
+            std::string_view text(const Token& token) const {
+                if (token.type == TokenType::EOF_) return "EOF";
+                if (token.owned) return strings[token.offset];
+                return source.substr(token.offset, token.length);
+            }
         };
+
+        TokenStream tokenize(std::string_view sourceCode);
     };
 }
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "optimizer.hpp"
+#include <climits>
+#include "../runtime/numbers.hpp"
+
+using namespace frontend;
+
+namespace {
+    bool isNumber(AST::Expr* expr, int value) {
+        return expr->kind == AST::NodeType::NumericLiteral && static_cast<AST::NumericLiteral*>(expr)->value == value;
+    }
+
+    // gives a number or null and nothing else, so adding 0 or multiplying by 1 leaves it as it was.
+    // + also joins two strings, so it only counts with an arithmetic side.
+    bool isArithmetic(AST::Expr* expr) {
+        if (expr->kind == AST::NodeType::NumericLiteral) return true;
+        if (expr->kind != AST::NodeType::BinaryExpr) return false;
+        auto binop = static_cast<AST::BinEx*>(expr);
+        return binop->op != AST::BinaryOp::Add || isArithmetic(binop->left) || isArithmetic(binop->right);
+    }
+
+    bool jumps(AST::Stmt* stmt) {
+        return stmt->kind == AST::NodeType::BreakStmt || stmt->kind == AST::NodeType::ContinueStmt || stmt->kind == AST::NodeType::ReturnStmt;
+    }
+}
+
+void Optimizer::optimize(AST::Program* program) {
+    Optimizer optimizer;
+    optimizer.program = program;
+    auto nullName = Symbols::intern("null");
+    auto trueName = Symbols::intern("true");
+    auto falseName = Symbols::intern("false");
+    // builtins come first and can't be declared again, so the first match is the builtin.
+    for (std::uint32_t slot = 0; slot < program->globals.size(); ++slot) {
+        auto name = program->globals[slot];
+        if (name == nullName && !optimizer.nullSlot) optimizer.nullSlot = slot;
+        if (name == trueName && !optimizer.trueSlot) optimizer.trueSlot = slot;
+        if (name == falseName && !optimizer.falseSlot) optimizer.falseSlot = slot;
+    }
+
+    program->body = optimizer.block(program->body);
+}
+
+AST::List<AST::Stmt*> Optimizer::list(const std::vector<AST::Stmt*>& items) {
+    AST::List<AST::Stmt*> result;
+    result.count = static_cast<std::uint32_t>(items.size());
+    if (!items.empty()) {
+        result.items = static_cast<AST::Stmt**>(program->arena->allocate(sizeof(AST::Stmt*) * items.size(), alignof(AST::Stmt*)));
+        std::copy(items.begin(), items.end(), result.items);
+    }
+    return result;
+}
+
+AST::Identifier* Optimizer::builtin(const char* name, std::uint32_t slot) {
+    auto ident = make<AST::Identifier>();
+    ident->symbol = Symbols::intern(name);
+    ident->depth = functionDepth;
+    ident->slot = slot;
+    return ident;
+}
+
+std::optional<bool> Optimizer::constantCondition(AST::Expr* condition) const {
+    switch (condition->kind) {
+        case AST::NodeType::NumericLiteral: {
+            return static_cast<AST::NumericLiteral*>(condition)->value != 0;
+        }
+        case AST::NodeType::StringLiteral: {
+            return true;
+        }
+        case AST::NodeType::Identifier: {
+            auto ident = static_cast<AST::Identifier*>(condition);
+            if (ident->depth != functionDepth) return std::nullopt;
+            if (ident->slot == trueSlot) return true;
+            if (ident->slot == falseSlot || ident->slot == nullSlot) return false;
+            return std::nullopt;
+        }
+        default: {
+            return std::nullopt;
+        }
+    }
+}
+
+// the value of an if is the value of its branch, so taking the branch's statements into the list is
+// the same thing. the last statement of a list gives the list's value though, an if there that runs
+// nothing has to stay to give null.
+AST::List<AST::Stmt*> Optimizer::block(const AST::List<AST::Stmt*>& body) {
+    std::vector<AST::Stmt*> result;
+    result.reserve(body.size());
+    bool changed = false;
+
+    for (std::size_t i = 0; i < body.size(); ++i) {
+        bool last = i + 1 == body.size();
+        auto stmt = statement(body[i]);
+        changed |= stmt != body[i];
+
+        if (stmt->kind == AST::NodeType::If) {
+            auto ifstmt = static_cast<AST::IfStmt*>(stmt);
+            if (auto taken = constantCondition(ifstmt->condition)) {
+                AST::List<AST::Stmt*> branch;
+                if (*taken) {
+                    branch = ifstmt->body;
+                } else if (ifstmt->elseStmt) {
+                    branch = ifstmt->elseStmt.value()->body;
+                }
+
+                if (!branch.empty() || !last) {
+                    result.insert(result.end(), branch.begin(), branch.end());
+                    changed = true;
+                    if (!branch.empty() && jumps(branch[branch.size() - 1])) break;
+                    continue;
+                }
+                ifstmt->body = {};
+                ifstmt->elseStmt.reset();
+            }
+        } else if (stmt->kind == AST::NodeType::While && !last) {
+            if (constantCondition(static_cast<AST::WhileStmt*>(stmt)->condition) == false) {
+                changed = true;
+                continue;
+            }
+        }
+
+        result.push_back(stmt);
+        if (jumps(stmt)) {
+            changed |= !last;
+            break;
+        }
+    }
+
+    return changed ? list(result) : body;
+}
+
+AST::Stmt* Optimizer::statement(AST::Stmt* stmt) {
+    switch (stmt->kind) {
+        case AST::NodeType::VarDeclare: {
+            auto declaration = static_cast<AST::VarDeclare*>(stmt);
+            if (declaration->value) {
+                declaration->value = expression(declaration->value.value());
+            }
+            return stmt;
+        }
+        case AST::NodeType::FunctionDeclaration: {
+            auto declaration = static_cast<AST::FunDeclare*>(stmt);
+            ++functionDepth;
+            declaration->body = block(declaration->body);
+            --functionDepth;
+            return stmt;
+        }
+        case AST::NodeType::If: {
+            auto ifstmt = static_cast<AST::IfStmt*>(stmt);
+            ifstmt->condition = expression(ifstmt->condition);
+            ifstmt->body = block(ifstmt->body);
+            if (ifstmt->elseStmt) {
+                auto elseStmt = ifstmt->elseStmt.value();
+                elseStmt->body = block(elseStmt->body);
+            }
+            return stmt;
+        }
+        case AST::NodeType::While: {
+            auto whilestmt = static_cast<AST::WhileStmt*>(stmt);
+            whilestmt->condition = expression(whilestmt->condition);
+            whilestmt->body = block(whilestmt->body);
+            return stmt;
+        }
+        case AST::NodeType::ReturnStmt: {
+            auto returnstmt = static_cast<AST::ReturnStmt*>(stmt);
+            if (returnstmt->value) {
+                returnstmt->value = expression(returnstmt->value.value());
+            }
+            return stmt;
+        }
+        case AST::NodeType::BreakStmt:
+        case AST::NodeType::ContinueStmt: {
+            return stmt;
+        }
+        default: {
+            return expression(static_cast<AST::Expr*>(stmt));
+        }
+    }
+}
+
+AST::Expr* Optimizer::expression(AST::Expr* expr) {
+    switch (expr->kind) {
+        case AST::NodeType::BinaryExpr: {
+            auto binop = static_cast<AST::BinEx*>(expr);
+            binop->left = expression(binop->left);
+            binop->right = expression(binop->right);
+            return foldBinary(binop);
+        }
+        case AST::NodeType::CompExpr: {
+            auto compEx = static_cast<AST::CompEx*>(expr);
+            compEx->left = expression(compEx->left);
+            compEx->right = expression(compEx->right);
+            return foldComparison(compEx);
+        }
+        case AST::NodeType::AssignmentExpr: {
+            auto assignment = static_cast<AST::AssignExpr*>(expr);
+            assignment->assigne = expression(assignment->assigne);
+            assignment->value = expression(assignment->value);
+            return expr;
+        }
+        case AST::NodeType::ObjectLiteral: {
+            for (auto prop : static_cast<AST::ObjectLiteral*>(expr)->properties) {
+                if (prop->value) {
+                    prop->value = expression(prop->value.value());
+                }
+            }
+            return expr;
+        }
+        case AST::NodeType::MemberExpr: {
+            auto member = static_cast<AST::MemberExpr*>(expr);
+            member->object = expression(member->object);
+            return expr;
+        }
+        case AST::NodeType::CallExpr: {
+            auto call = static_cast<AST::CallExpr*>(expr);
+            call->caller = expression(call->caller);
+            for (auto& arg : call->args) {
+                arg = expression(arg);
+            }
+            return expr;
+        }
+        default: {
+            return expr;
+        }
+    }
+}
+
+AST::Expr* Optimizer::foldBinary(AST::BinEx* binop) {
+    auto left = binop->left;
+    auto right = binop->right;
+
+    if (left->kind == AST::NodeType::NumericLiteral && right->kind == AST::NodeType::NumericLiteral) {
+        int lhs = static_cast<AST::NumericLiteral*>(left)->value;
+        int rhs = static_cast<AST::NumericLiteral*>(right)->value;
+        // dividing by zero is left for the runtime to deal with, however it does.
+        bool divides = binop->op == AST::BinaryOp::Div || binop->op == AST::BinaryOp::Mod;
+        if (divides && (rhs == 0 || (lhs == INT_MIN && rhs == -1))) return binop;
+
+        // the same kernel the engines run, so a folded result is the one the runtime would have given.
+        auto num = make<AST::NumericLiteral>();
+        num->value = runtime::numbers::arithmetic(binop->op, lhs, rhs);
+        return num;
+    }
+
+    switch (binop->op) {
+        case AST::BinaryOp::Add: {
+            if (isNumber(right, 0) && isArithmetic(left)) return left;
+            if (isNumber(left, 0) && isArithmetic(right)) return right;
+            break;
+        }
+        case AST::BinaryOp::Sub: {
+            if (isNumber(right, 0) && isArithmetic(left)) return left;
+            break;
+        }
+        case AST::BinaryOp::Mul: {
+            if (isNumber(right, 1) && isArithmetic(left)) return left;
+            if (isNumber(left, 1) && isArithmetic(right)) return right;
+            break;
+        }
+        case AST::BinaryOp::Div: {
+            if (isNumber(right, 1) && isArithmetic(left)) return left;
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    return binop;
+}
+
+AST::Expr* Optimizer::foldComparison(AST::CompEx* compEx) {
+    if (compEx->left->kind != AST::NodeType::NumericLiteral || compEx->right->kind != AST::NodeType::NumericLiteral) return compEx;
+    if (!trueSlot || !falseSlot) return compEx;
+
+    int left = static_cast<AST::NumericLiteral*>(compEx->left)->value;
+    int right = static_cast<AST::NumericLiteral*>(compEx->right)->value;
+    return runtime::numbers::compare(compEx->op, left, right) ? builtin("true", *trueSlot) : builtin("false", *falseSlot);
+}
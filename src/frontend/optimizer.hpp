@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "ast.hpp"
+
+namespace frontend {
+    // runs after the resolver, so anything it throws away has still been checked. rewrites the tree in
+    // place, every engine and the cache only ever see the result.
+    //
+    // arithmetic and comparisons on two number literals are done here, the same way the runtime would
+    // do them. a comparison becomes a read of the builtin true or false. x + 0, x * 1 and the like
+    // become x, but only when x is itself arithmetic, because anything that isn't a number gives null.
+    // ifs with a constant condition are replaced by the branch that runs, and statements after a
+    // break, continue or return are dropped.
+    class Optimizer {
+    public:
+        static void optimize(AST::Program* program);
+    private:
+        AST::Program* program = nullptr;
+        std::uint32_t functionDepth = 0; // how far the current code is from the global scope
+        // global slots of the builtin constants, conditions that read them are known up front.
+        std::optional<std::uint32_t> nullSlot;
+        std::optional<std::uint32_t> trueSlot;
+        std::optional<std::uint32_t> falseSlot;
+
+        AST::Expr* expression(AST::Expr* expr);
+        AST::Stmt* statement(AST::Stmt* stmt);
+        AST::List<AST::Stmt*> block(const AST::List<AST::Stmt*>& body);
+
+        AST::Expr* foldBinary(AST::BinEx* binop);
+        AST::Expr* foldComparison(AST::CompEx* compEx);
+        std::optional<bool> constantCondition(AST::Expr* condition) const;
+        AST::Identifier* builtin(const char* name, std::uint32_t slot);
+
+        template <typename T>
+        T* make() {
+            auto node = program->arena->make<T>();
+            program->nodeCounts[static_cast<std::size_t>(node->kind)]++;
+            return node;
+        }
+        AST::List<AST::Stmt*> list(const std::vector<AST::Stmt*>& items);
+    };
+}
@@ -1,24 +1,32 @@
 #include "parser.hpp"
+#include <charconv>
 
 using namespace frontend;
 
 bool Parser::notEOF() {
-    return this->tokens[0]->type != Lexer::TokenType::EOF_;
+    return at()->type != Lexer::TokenType::EOF_;
 }
 
-Lexer::Token* Parser::at() {
-    return this->tokens[0];
+const Lexer::Token* Parser::at() {
+    return &this->tokens[cursor];
 }
 
-Lexer::Token* Parser::eat() {
-    auto prev = tokens.front();
-    tokens.pop_front();
+// looks past the current token without eating anything, anything past the end is the EOF token.
+const Lexer::Token* Parser::peek(std::size_t ahead) {
+    return &this->tokens[std::min(cursor + ahead, tokens.size() - 1)];
+}
+
+// the cursor never moves past EOF, so eating at the end keeps returning it.
+const Lexer::Token* Parser::eat() {
+    auto prev = at();
+    if (prev->type != Lexer::TokenType::EOF_) {
+        cursor++;
+    }
     return prev;
 }
 
-Lexer::Token* Parser::expect(Lexer::TokenType type,  std::string err) {
-    auto prev = tokens.front();
-    tokens.pop_front();
+const Lexer::Token* Parser::expect(Lexer::TokenType type,  std::string err) {
+    auto prev = eat();
     if (prev->type != type) {
         throw std::invalid_argument(fmt::format("Parser Error: {}", err));
     }
@@ -31,16 +39,22 @@ AST::Expr* Parser::parse_primary_expr() {
 
     switch (tk) {
         case Lexer::TokenType::Identifier: {
-            auto ident = new AST::Identifier();
-            ident->symbol = eat()->value;
+            auto ident = make<AST::Identifier>();
+            ident->symbol = eat()->symbol;
             return ident;
         }
         case Lexer::TokenType::Int: {
-            auto num = new AST::NumericLiteral();
+            auto num = make<AST::NumericLiteral>();
             num->kind = AST::NodeType::NumericLiteral;
-            num->value = std::stoi(eat()->value);
+            auto text = value(eat());
+            if (std::from_chars(text.data(), text.data() + text.size(), num->value).ec != std::errc()) {
+                throw std::invalid_argument(fmt::format("Parser Error: Invalid integer literal '{}'.", text));
+            }
             return num;
         }
+        case Lexer::TokenType::String: {
+            return this->parse_string(); // down here so strings can be operands, "a" + "b"
+        }
         case Lexer::TokenType::OpenParen: {
             eat();
             auto value = this->parse_expr();
@@ -48,7 +62,7 @@ AST::Expr* Parser::parse_primary_expr() {
             return value;
         }
         default: {
-            throw std::runtime_error(fmt::format("{}:{}: Unexpected token found: '{}'", fileName, at()->position, at()->value));
+            throw std::runtime_error(fmt::format("{}:{}: Unexpected token found: '{}'", fileName, at()->position, value(at())));
         }
     }
 }
@@ -56,10 +70,10 @@ AST::Expr* Parser::parse_primary_expr() {
 AST::Expr* Parser::parse_additive_expr() {
     auto left = this->parse_multiplicative_expr();
 
-    while (at()->value == "+" || at()->value == "-") {
-        auto op = eat()->value;
+    while (value(at()) == "+" || value(at()) == "-") {
+        auto op = value(eat()) == "+" ? AST::BinaryOp::Add : AST::BinaryOp::Sub;
         auto right = this->parse_multiplicative_expr();
-        auto binop = new AST::BinEx();
+        auto binop = make<AST::BinEx>();
         binop->left = left;
         binop->right = right;
         binop->op = op;
@@ -80,10 +94,9 @@ AST::Expr* Parser::parse_call_member_expr() {
 }
 
 AST::Expr* Parser::parse_call_expr(AST::Expr* caller) {
-    auto call_expr = new AST::Expr();
-    call_expr = new AST::CallExpr();
+    AST::Expr* call_expr = make<AST::CallExpr>();
     static_cast<AST::CallExpr*>(call_expr)->caller = caller;
-    static_cast<AST::CallExpr*>(call_expr)->args = this->parse_args();
+    static_cast<AST::CallExpr*>(call_expr)->args = list(this->parse_args());
 
     if (at()->type == Lexer::TokenType::OpenParen) {
         call_expr = this->parse_call_expr(call_expr);
@@ -92,9 +105,9 @@ AST::Expr* Parser::parse_call_expr(AST::Expr* caller) {
     return call_expr;
 }
 
-std::deque<AST::Expr*> Parser::parse_args() {
+std::vector<AST::Expr*> Parser::parse_args() {
     expect(Lexer::TokenType::OpenParen, "Expected open parenthesis.");
-    std::deque<AST::Expr*> args;
+    std::vector<AST::Expr*> args;
     if (at()->type != Lexer::TokenType::CloseParen) {
         args = parse_arguments_list();
     }
@@ -104,8 +117,8 @@ std::deque<AST::Expr*> Parser::parse_args() {
     return args;
 }
 
-std::deque<AST::Expr*> Parser::parse_arguments_list() {
-    std::deque<AST::Expr*> args;
+std::vector<AST::Expr*> Parser::parse_arguments_list() {
+    std::vector<AST::Expr*> args;
 
     while (notEOF() && at()->type != Lexer::TokenType::CloseParen) {
         args.push_back(this->parse_expr());
@@ -134,7 +147,7 @@ AST::Expr* Parser::parse_member_expr() {
         }
         
 
-        auto memberExpr = new AST::MemberExpr();
+        auto memberExpr = make<AST::MemberExpr>();
         memberExpr->object = object;
         memberExpr->property = property;
 
@@ -147,10 +160,11 @@ AST::Expr* Parser::parse_member_expr() {
 AST::Expr* Parser::parse_multiplicative_expr() {
     auto left = this->parse_call_member_expr();
 
-    while (at()->value == "/" || at()->value == "*" || at()->value == "%") {
-        auto op = eat()->value;
+    while (value(at()) == "/" || value(at()) == "*" || value(at()) == "%") {
+        auto text = value(eat());
+        auto op = text == "/" ? AST::BinaryOp::Div : text == "*" ? AST::BinaryOp::Mul : AST::BinaryOp::Mod;
         auto right = this->parse_call_member_expr();
-        auto binop = new AST::BinEx();
+        auto binop = make<AST::BinEx>();
         binop->left = left;
         binop->right = right;
         binop->op = op;
@@ -166,10 +180,15 @@ AST::Expr* Parser::parse_comparison_expr() {
     auto left = parse_assignment_expr();
 
     while (at()->type == Lexer::TokenType::ComparisonOp) {
-        auto op = eat()->value;
+        auto text = value(eat());
+        auto op = AST::CompareOp::LessEqual;
+        if (text == "<") op = AST::CompareOp::Less; else
+        if (text == ">") op = AST::CompareOp::Greater; else
+        if (text == "==") op = AST::CompareOp::Equal; else
+        if (text == ">=") op = AST::CompareOp::GreaterEqual;
         auto right = parse_assignment_expr();
 
-        auto binop = new AST::CompEx();
+        auto binop = make<AST::CompEx>();
         binop->left = left;
         binop->right = right;
         binop->op = op;
@@ -185,7 +204,7 @@ AST::Expr* Parser::parse_assignment_expr() {
     if (at()->type == Lexer::TokenType::Equals) {
         eat();
         auto value = this->parse_assignment_expr();
-        auto return_val = new AST::AssignExpr();
+        auto return_val = make<AST::AssignExpr>();
         return_val->value = value;
         return_val->assigne = left;
         return return_val;
@@ -200,15 +219,15 @@ AST::Expr* Parser::parse_object_expr() {
     }
 
     eat();
-    std::deque<AST::Property*> properties;
+    std::vector<AST::Property*> properties;
 
     while (notEOF() && at()->type != Lexer::TokenType::CloseBrace) {
-        auto key = this->expect(Lexer::TokenType::Identifier, "Expected identifier for object literal.")->value;
+        auto key = this->expect(Lexer::TokenType::Identifier, "Expected identifier for object literal.");
         if (at()->type == Lexer::TokenType::Comma || at()->type == Lexer::TokenType::CloseBrace) {
-            auto property = new AST::Property();
-            property->key = key;
-            auto ident = new AST::Identifier();
-            ident->symbol = key;
+            auto property = make<AST::Property>();
+            property->key = key->symbol;
+            auto ident = make<AST::Identifier>();
+            ident->symbol = key->symbol;
             property->value = ident;
             properties.push_back(property);
             continue;
@@ -222,10 +241,10 @@ AST::Expr* Parser::parse_object_expr() {
         expect(Lexer::TokenType::Colon, "Missing colon following identifier in ObjectExpr");
         auto value = this->parse_expr();
 
-        auto property = new AST::Property();
+        auto property = make<AST::Property>();
 
         property->value = value;
-        property->key = key;
+        property->key = key->symbol;
         properties.push_back(property);
         if (at()->type != Lexer::TokenType::CloseBrace) {
             expect(Lexer::TokenType::Comma, "Expected comma following property.");
@@ -233,17 +252,17 @@ AST::Expr* Parser::parse_object_expr() {
     }
 
     expect(Lexer::TokenType::CloseBrace, "Object literal missing closing Braces.");
-    auto return_val = new AST::ObjectLiteral();
-    return_val->properties = properties;
+    auto return_val = make<AST::ObjectLiteral>();
+    return_val->properties = list(properties);
     return return_val;
 }
 
 AST::Stmt* Parser::parse_fun_declaration() {
     eat(); // eating fun
-    auto name = expect(Lexer::TokenType::Identifier, "Expected identifier after `fun` keyword")->value;
+    auto name = expect(Lexer::TokenType::Identifier, "Expected identifier after `fun` keyword");
 
     auto args = parse_args(); // we dont need to use another function for parsing params, this is enough.
-    std::deque<std::string> params;
+    std::vector<SymbolId> params;
 
     for (auto& arg : args) {
         if (arg->kind != AST::NodeType::Identifier) {
@@ -255,53 +274,49 @@ AST::Stmt* Parser::parse_fun_declaration() {
 
     expect(Lexer::TokenType::OpenBrace, "Expected '{' following function declaration.");
 
-    std::deque<AST::Stmt*> body;
+    std::vector<AST::Stmt*> body;
 
     while (at()->type != Lexer::TokenType::EOF_ && at()->type != Lexer::TokenType::CloseBrace) {
         body.push_back(parse_stmt());
     }
 
     expect(Lexer::TokenType::CloseBrace, "Expected closing brace inside function declaration.");
-    auto fn = new AST::FunDeclare();
-    fn->body = body;
-    fn->name = name;
-    fn->parameters = params;
+    auto fn = make<AST::FunDeclare>();
+    fn->body = list(body);
+    fn->name = name->symbol;
+    fn->parameters = list(params);
     return fn;
 }
 
 AST::Expr* Parser::parse_string() {
-    auto val = new AST::StringLiteral();
-    val->value = eat()->value;
+    auto val = make<AST::StringLiteral>();
+    val->value = value(eat());
     return val;
 }
 
 AST::Expr* Parser::parse_expr() {
-    switch (at()->type) {
-        case Lexer::TokenType::String: {
-            return this->parse_string();
-        }
-        default: {
-            return this->parse_comparison_expr();
-        }
-    }
+    return this->parse_comparison_expr();
 }
 
 AST::Stmt* Parser::parse_var_declaration() {
     auto isConstant = eat()->type == Lexer::TokenType::Const;
-    auto identifier = expect(Lexer::TokenType::Identifier, "Expected identifier following var | const")->value;
+    auto identifier = expect(Lexer::TokenType::Identifier, "Expected identifier following var | const");
 
     if (at()->type == Lexer::TokenType::Semicolon) {
         eat();
         if (isConstant)
             throw std::invalid_argument("No value given for const expression.");
-        
-        return new AST::VarDeclare();
+
+        auto declaration = make<AST::VarDeclare>();
+        declaration->identifier = identifier->symbol;
+        declaration->constant = false;
+        return declaration;
     }
 
     expect(Lexer::TokenType::Equals, "Expected Equals following identifier.");
-    auto declaration = new AST::VarDeclare();
+    auto declaration = make<AST::VarDeclare>();
     declaration->value = this->parse_expr();
-    declaration->identifier = identifier;
+    declaration->identifier = identifier->symbol;
     declaration->constant = isConstant;
 
     expect(Lexer::TokenType::Semicolon, "Expected ';' for variable declaration.");
@@ -312,16 +327,17 @@ AST::Stmt* Parser::parse_var_declaration() {
 AST::Stmt* Parser::parse_if_condition() {
     eat(); // eat the if keyword
 
-    auto ifstmt = new AST::IfStmt();
+    auto ifstmt = make<AST::IfStmt>();
     ifstmt->condition = this->parse_expr();
 
+    std::vector<AST::Stmt*> body;
 
     if (at()->type == Lexer::TokenType::OpenBrace) {
         eat();
         ifstmt->multiline = true;
 
         while (at()->type != Lexer::TokenType::EOF_ && at()->type != Lexer::TokenType::CloseBrace) {
-            ifstmt->body.push_back(parse_stmt());
+            body.push_back(parse_stmt());
         }
 
         expect(Lexer::TokenType::CloseBrace, "Expected closing brace for if statement.");
@@ -329,22 +345,25 @@ AST::Stmt* Parser::parse_if_condition() {
         ifstmt->multiline = false;
 
         while (notEOF() && at()->type != Lexer::TokenType::Semicolon) {
-            ifstmt->body.push_back(parse_stmt());
+            body.push_back(parse_stmt());
         }
 
         expect(Lexer::TokenType::Semicolon, "Expected semicolon after single-line if statement.");
     }
 
+    ifstmt->body = list(body);
+
     if (at()->type == Lexer::TokenType::Else) {
         eat();
-        auto elsestmt = new AST::ElseStmt();
+        auto elsestmt = make<AST::ElseStmt>();
+        body.clear();
 
         if (at()->type == Lexer::TokenType::OpenBrace) {
             elsestmt->multiline = true;
             eat();
 
             while (notEOF() && at()->type != Lexer::TokenType::CloseBrace) {
-                elsestmt->body.push_back(parse_stmt());
+                body.push_back(parse_stmt());
             }
 
             expect(Lexer::TokenType::CloseBrace, "Expected closing brace after `else` statement.");
@@ -352,12 +371,13 @@ AST::Stmt* Parser::parse_if_condition() {
             elsestmt->multiline = false;
 
             while (at()->type != Lexer::TokenType::EOF_ && at()->type != Lexer::TokenType::Semicolon) {
-                elsestmt->body.push_back(parse_stmt());
+                body.push_back(parse_stmt());
             }
 
             expect(Lexer::TokenType::Semicolon, "Expected semicolon after single-line `else` statement.");
         }
 
+        elsestmt->body = list(body);
         ifstmt->elseStmt = elsestmt;
     }
 
@@ -367,31 +387,51 @@ AST::Stmt* Parser::parse_if_condition() {
 AST::Stmt* Parser::parse_while_statement() {
     eat(); // eat the while keyword
 
-    auto whilestmt = new AST::WhileStmt();
+    auto whilestmt = make<AST::WhileStmt>();
     whilestmt->condition = this->parse_expr();
 
+    std::vector<AST::Stmt*> body;
+
     if (at()->type == Lexer::TokenType::OpenBrace) {
         whilestmt->multiline = true;
         eat();
         while (notEOF() && at()->type != Lexer::TokenType::CloseBrace) {
-            whilestmt->body.push_back(parse_stmt());
+            body.push_back(parse_stmt());
         }
         expect(Lexer::TokenType::CloseBrace, "Expected closing Brace after while statement.");
     } else {
         whilestmt->multiline = false;
 
         while (notEOF() && at()->type != Lexer::TokenType::Semicolon) {
-            whilestmt->body.push_back(parse_stmt());
+            body.push_back(parse_stmt());
         }
         expect(Lexer::TokenType::Semicolon, "Expected ';' after single-line while statement.");
     }
 
+    whilestmt->body = list(body);
+
     return whilestmt;
 }
 
 AST::Stmt* Parser::parse_break_statement() {
     eat();
-    auto stmt = new AST::BreakStmt();
+    auto stmt = make<AST::BreakStmt>();
+    return stmt;
+}
+
+AST::Stmt* Parser::parse_continue_statement() {
+    eat();
+    return make<AST::ContinueStmt>();
+}
+
+AST::Stmt* Parser::parse_return_statement() {
+    eat();
+    auto stmt = make<AST::ReturnStmt>();
+    // a bare return is followed by the end of its block (or of a single line body).
+    auto next = at()->type;
+    if (next != Lexer::TokenType::CloseBrace && next != Lexer::TokenType::Semicolon && next != Lexer::TokenType::EOF_) {
+        stmt->value = parse_expr();
+    }
     return stmt;
 }
 
@@ -415,20 +455,38 @@ AST::Stmt* Parser::parse_stmt() {
         case Lexer::TokenType::Break: {
             return this->parse_break_statement();
         }
+        case Lexer::TokenType::Continue: {
+            return this->parse_continue_statement();
+        }
+        case Lexer::TokenType::Return: {
+            return this->parse_return_statement();
+        }
         default: {
             return this->parse_expr();
         }
     }
 }
 
-AST::Program* Parser::produceAST(utils::File* file) {
-    this->tokens = lexer->tokenize(file->contents);
+std::unique_ptr<AST::Program> Parser::produceAST(utils::File* file) {
+    this->stream = lexer->tokenize(file->contents);
+    this->tokens = stream.tokens;
+    this->cursor = 0;
     this->fileName = file->name;
-    auto program = new AST::Program();
+    auto program = std::make_unique<AST::Program>();
+    this->program = program.get();
+    this->arena = program->arena.get();
 
+    std::vector<AST::Stmt*> body;
     while (notEOF()) {
-        program->body.push_back(this->parse_stmt());
+        body.push_back(this->parse_stmt());
     }
+    program->body = list(body);
+
+    // the AST doesnt point into the tokens, so the whole buffer can go in one go.
+    this->tokens = {};
+    this->stream = Lexer::TokenStream();
+    this->arena = nullptr;
+    this->program = nullptr;
 
     return program;
 }
\ No newline at end of file
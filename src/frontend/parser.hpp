@@ -3,13 +3,39 @@
 #include "ast.hpp"
 #include "../utils.hpp"
 #include <deque>
+#include <span>
+#include <vector>
 #include "fmt/core.h"
 
 namespace frontend {
     class Parser {
     private:
         Lexer* lexer;
-        std::deque<Lexer::Token*> tokens;
+        Lexer::TokenStream stream;
+        std::span<const Lexer::Token> tokens;
+        std::size_t cursor = 0;
+        AstArena* arena = nullptr;
+        AST::Program* program = nullptr;
+
+        // every node goes through here so the program can keep count of them.
+        template <typename T>
+        T* make() {
+            auto node = arena->make<T>();
+            program->nodeCounts[static_cast<std::size_t>(node->kind)]++;
+            return node;
+        }
+
+        // copies a finished child list into the arena.
+        template <typename T>
+        AST::List<T> list(const std::vector<T>& items) {
+            AST::List<T> result;
+            result.count = static_cast<std::uint32_t>(items.size());
+            if (!items.empty()) {
+                result.items = static_cast<T*>(arena->allocate(sizeof(T) * items.size(), alignof(T)));
+                std::copy(items.begin(), items.end(), result.items);
+            }
+            return result;
+        }
         std::string fileName;
 
         bool notEOF();
@@ -23,8 +49,8 @@ namespace frontend {
         AST::Expr* parse_object_expr();
         AST::Expr* parse_call_member_expr();
         AST::Expr* parse_call_expr(AST::Expr* caller);
-        std::deque<AST::Expr*> parse_args();
-        std::deque<AST::Expr*> parse_arguments_list();
+        std::vector<AST::Expr*> parse_args();
+        std::vector<AST::Expr*> parse_arguments_list();
         AST::Expr* parse_member_expr();
         AST::Stmt* parse_fun_declaration();
         AST::Stmt* parse_if_condition();
@@ -32,14 +58,27 @@ namespace frontend {
         AST::Expr* parse_string();
         AST::Stmt* parse_while_statement();
         AST::Stmt* parse_break_statement();
-        Lexer::Token* eat();
-        Lexer::Token* at();
-        Lexer::Token* expect(Lexer::TokenType type, std::string err);
+        AST::Stmt* parse_continue_statement();
+        AST::Stmt* parse_return_statement();
+        const Lexer::Token* eat();
+        const Lexer::Token* at();
+        const Lexer::Token* peek(std::size_t ahead);
+        const Lexer::Token* expect(Lexer::TokenType type, std::string err);
+        // for backtracking, rewind(mark()) puts the cursor back where it was.
+        std::size_t mark() const {
+            return cursor;
+        }
+        void rewind(std::size_t mark) {
+            cursor = mark;
+        }
+        std::string_view value(const Lexer::Token* token) const {
+            return stream.text(*token);
+        }
     public:
     Parser() {
         lexer = new Lexer();
     }
-    AST::Program* produceAST(utils::File* source);
+    std::unique_ptr<AST::Program> produceAST(utils::File* source);
 
     };
 }
\ No newline at end of file
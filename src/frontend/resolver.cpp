@@ -0,0 +1,222 @@
+#include "resolver.hpp"
+#include <stdexcept>
+#include <fmt/core.h>
+
+using namespace frontend;
+
+void Resolver::resolve(AST::Program* program, std::span<const SymbolId> builtins) {
+    Resolver resolver;
+    resolver.program = program;
+    resolver.scopes.emplace_back();
+    for (auto name : builtins) {
+        resolver.declare(name);
+    }
+
+    resolver.statements(program->body);
+    resolver.finishScope();
+    program->globals = resolver.layout(resolver.scopes.back());
+}
+
+std::uint32_t Resolver::declare(SymbolId name) {
+    auto& scope = scopes.back();
+    auto slot = static_cast<std::uint32_t>(scope.locals.size());
+    if (!scope.slots.emplace(name, slot).second) {
+        throw std::invalid_argument(fmt::format("Variable {} is already declared.", Symbols::name(name)));
+    }
+    scope.locals.push_back(name);
+    return slot;
+}
+
+void Resolver::resolveIdentifier(AST::Identifier* ident) {
+    for (std::size_t i = scopes.size(); i-- > 0;) {
+        auto it = scopes[i].slots.find(ident->symbol);
+        if (it != scopes[i].slots.end()) {
+            ident->depth = static_cast<std::uint32_t>(scopes.size() - 1 - i);
+            ident->slot = it->second;
+            return;
+        }
+    }
+    throw std::invalid_argument(fmt::format("Cannot resolve {} as it doesn't exist.", Symbols::name(ident->symbol)));
+}
+
+void Resolver::statements(const AST::List<AST::Stmt*>& body) {
+    for (auto stmt : body) {
+        statement(stmt);
+    }
+}
+
+void Resolver::finishScope() {
+    // pending can grow while this runs, nested functions only get queued on their own scope though.
+    for (std::size_t i = 0; i < scopes.back().pending.size(); ++i) {
+        function(scopes.back().pending[i]);
+    }
+}
+
+void Resolver::function(AST::FunDeclare* declaration) {
+    scopes.emplace_back();
+    for (auto param : declaration->parameters) {
+        declare(param);
+    }
+    statements(declaration->body);
+    declaration->captured = !scopes.back().pending.empty();
+    if (!declaration->captured) {
+        markTailCalls(declaration->body, true);
+    }
+    finishScope();
+    declaration->locals = layout(scopes.back());
+    scopes.pop_back();
+}
+
+// a call is the last thing its function does when it's returned, or when it's the function's last
+// statement (a function's value is its last statement's), possibly at the end of an if that is.
+void Resolver::markTailCalls(const AST::List<AST::Stmt*>& body, bool last) {
+    for (std::size_t i = 0; i < body.size(); ++i) {
+        auto stmt = body[i];
+        bool tail = last && i + 1 == body.size();
+        switch (stmt->kind) {
+            case AST::NodeType::CallExpr: {
+                static_cast<AST::CallExpr*>(stmt)->tail = tail;
+                break;
+            }
+            case AST::NodeType::ReturnStmt: {
+                auto returnstmt = static_cast<AST::ReturnStmt*>(stmt);
+                if (returnstmt->value && returnstmt->value.value()->kind == AST::NodeType::CallExpr) {
+                    static_cast<AST::CallExpr*>(returnstmt->value.value())->tail = true;
+                }
+                break;
+            }
+            case AST::NodeType::If: {
+                auto ifstmt = static_cast<AST::IfStmt*>(stmt);
+                markTailCalls(ifstmt->body, tail);
+                if (ifstmt->elseStmt) {
+                    markTailCalls(ifstmt->elseStmt.value()->body, tail);
+                }
+                break;
+            }
+            case AST::NodeType::While: {
+                markTailCalls(static_cast<AST::WhileStmt*>(stmt)->body, false);
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+}
+
+AST::List<SymbolId> Resolver::layout(const Scope& scope) {
+    AST::List<SymbolId> result;
+    result.count = static_cast<std::uint32_t>(scope.locals.size());
+    if (!scope.locals.empty()) {
+        result.items = static_cast<SymbolId*>(program->arena->allocate(sizeof(SymbolId) * scope.locals.size(), alignof(SymbolId)));
+        std::copy(scope.locals.begin(), scope.locals.end(), result.items);
+    }
+    return result;
+}
+
+void Resolver::statement(AST::Stmt* stmt) {
+    switch (stmt->kind) {
+        case AST::NodeType::Identifier: {
+            resolveIdentifier(static_cast<AST::Identifier*>(stmt));
+            break;
+        }
+        case AST::NodeType::BinaryExpr: {
+            auto binop = static_cast<AST::BinEx*>(stmt);
+            statement(binop->left);
+            statement(binop->right);
+            break;
+        }
+        case AST::NodeType::CompExpr: {
+            auto compEx = static_cast<AST::CompEx*>(stmt);
+            statement(compEx->left);
+            statement(compEx->right);
+            break;
+        }
+        case AST::NodeType::VarDeclare: {
+            // the value can still see an outer variable with the same name.
+            auto declaration = static_cast<AST::VarDeclare*>(stmt);
+            if (declaration->value) {
+                statement(declaration->value.value());
+            }
+            declaration->slot = declare(declaration->identifier);
+            break;
+        }
+        case AST::NodeType::AssignmentExpr: {
+            auto assign = static_cast<AST::AssignExpr*>(stmt);
+            if (assign->assigne->kind != AST::NodeType::Identifier) {
+                throw std::runtime_error("Invalid LHS in assignment expression.");
+            }
+            statement(assign->value);
+            resolveIdentifier(static_cast<AST::Identifier*>(assign->assigne));
+            break;
+        }
+        case AST::NodeType::ObjectLiteral: {
+            for (auto prop : static_cast<AST::ObjectLiteral*>(stmt)->properties) {
+                if (prop->value && prop->value.value()) {
+                    statement(prop->value.value());
+                }
+            }
+            break;
+        }
+        case AST::NodeType::MemberExpr: {
+            statement(static_cast<AST::MemberExpr*>(stmt)->object);
+            break;
+        }
+        case AST::NodeType::CallExpr: {
+            auto call = static_cast<AST::CallExpr*>(stmt);
+            for (auto arg : call->args) {
+                statement(arg);
+            }
+            statement(call->caller);
+            break;
+        }
+        case AST::NodeType::FunctionDeclaration: {
+            auto declaration = static_cast<AST::FunDeclare*>(stmt);
+            declaration->slot = declare(declaration->name);
+            scopes.back().pending.push_back(declaration);
+            break;
+        }
+        case AST::NodeType::If: {
+            auto ifstmt = static_cast<AST::IfStmt*>(stmt);
+            statement(ifstmt->condition);
+            statements(ifstmt->body);
+            if (ifstmt->elseStmt) {
+                statements(ifstmt->elseStmt.value()->body);
+            }
+            break;
+        }
+        case AST::NodeType::While: {
+            auto whilestmt = static_cast<AST::WhileStmt*>(stmt);
+            statement(whilestmt->condition);
+            ++scopes.back().loops;
+            statements(whilestmt->body);
+            --scopes.back().loops;
+            break;
+        }
+        case AST::NodeType::BreakStmt: {
+            if (scopes.back().loops == 0) {
+                throw std::runtime_error("break outside of a loop.");
+            }
+            break;
+        }
+        case AST::NodeType::ContinueStmt: {
+            if (scopes.back().loops == 0) {
+                throw std::runtime_error("continue outside of a loop.");
+            }
+            break;
+        }
+        case AST::NodeType::ReturnStmt: {
+            if (scopes.size() == 1) {
+                throw std::runtime_error("return outside of a function.");
+            }
+            auto returnstmt = static_cast<AST::ReturnStmt*>(stmt);
+            if (returnstmt->value) {
+                statement(returnstmt->value.value());
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "ast.hpp"
+
+namespace frontend {
+    // runs between parsing and evaluation. gives every variable a (depth, slot) address, depth being
+    // how many function scopes to go up and slot its index in that scope, so the runtime never looks
+    // names up. undeclared and duplicate names are reported here instead of when the code runs.
+    //
+    // if and while bodies share their function's scope, each function call gets a new one. inside the
+    // current scope a name only counts once it's been declared, enclosing scopes are complete by the
+    // time a function body gets resolved, so functions can use globals declared after them.
+    //
+    // it also checks break and continue are in a loop and return is in a function, and marks tail
+    // calls, but only in functions that don't declare functions of their own. a nested function keeps
+    // the scope it was declared in, so that scope can't be handed to the next call. those functions are
+    // marked captured, their calls need a scope that outlives them.
+    class Resolver {
+    public:
+        // builtins are the names already declared in the global scope, in slot order.
+        static void resolve(AST::Program* program, std::span<const SymbolId> builtins);
+    private:
+        struct Scope {
+            std::vector<SymbolId> locals;
+            std::unordered_map<SymbolId, std::uint32_t> slots;
+            // function bodies wait until the scope around them is done.
+            std::vector<AST::FunDeclare*> pending;
+            std::uint32_t loops = 0; // how many whiles deep the current statement is
+        };
+
+        AST::Program* program = nullptr;
+        std::vector<Scope> scopes;
+
+        std::uint32_t declare(SymbolId name);
+        void resolveIdentifier(AST::Identifier* ident);
+        void statement(AST::Stmt* stmt);
+        void statements(const AST::List<AST::Stmt*>& body);
+        void function(AST::FunDeclare* declaration);
+        void finishScope();
+        void markTailCalls(const AST::List<AST::Stmt*>& body, bool last);
+        AST::List<SymbolId> layout(const Scope& scope);
+    };
+}
@@ -0,0 +1,246 @@
+#include "scan.hpp"
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define YHS_SCAN_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define YHS_TARGET_AVX2
+    #else
+        #define YHS_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+using namespace frontend;
+
+namespace {
+    enum class Run {
+        Whitespace,
+        LineEnd,
+        Identifier,
+        Digits,
+        StringStop
+    };
+
+    // only whitespace and strings can run over a newline, the rest stop before it anyway.
+    template <Run R>
+    constexpr bool countsLines() {
+        return R == Run::Whitespace || R == Run::StringStop;
+    }
+
+    template <Run R>
+    inline bool isStop(char ch) {
+        if constexpr (R == Run::Whitespace) return !(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n');
+        else if constexpr (R == Run::LineEnd) return ch == '\n';
+        else if constexpr (R == Run::Identifier) return static_cast<unsigned char>((ch | 0x20) - 'a') >= 26;
+        else if constexpr (R == Run::Digits) return static_cast<unsigned char>(ch - '0') >= 10;
+        else return ch == '\"' || ch == '\\';
+    }
+
+    template <Run R>
+    const char* scalarFind(const char* p, const char* end, int& lines) {
+        for (; p < end; ++p) {
+            if (isStop<R>(*p)) break;
+            if constexpr (countsLines<R>()) lines += *p == '\n';
+        }
+        return p;
+    }
+
+    const char* scalarCommentEnd(const char* p, const char* end, int& lines) {
+        for (; p + 1 < end; ++p) {
+            if (p[0] == '*' && p[1] == '/') return p;
+            lines += *p == '\n';
+        }
+        if (p < end) lines += *p == '\n';
+        return end;
+    }
+
+    // bits below the first stop, so newlines past the end of the run dont get counted.
+    inline std::uint32_t beforeFirst(std::uint32_t mask) {
+        return (mask & (0u - mask)) - 1;
+    }
+
+#ifdef YHS_SCAN_X86
+    template <Run R>
+    inline std::uint32_t sse2StopMask(__m128i v) {
+        if constexpr (R == Run::Whitespace) {
+            auto ws = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))
+            );
+            return ~static_cast<std::uint32_t>(_mm_movemask_epi8(ws)) & 0xFFFF;
+        } else if constexpr (R == Run::LineEnd) {
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        } else if constexpr (R == Run::Identifier) {
+            auto x = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+            auto letter = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(25)), x);
+            return ~static_cast<std::uint32_t>(_mm_movemask_epi8(letter)) & 0xFFFF;
+        } else if constexpr (R == Run::Digits) {
+            auto x = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+            auto digit = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(9)), x);
+            return ~static_cast<std::uint32_t>(_mm_movemask_epi8(digit)) & 0xFFFF;
+        } else {
+            auto stop = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(stop));
+        }
+    }
+
+    template <Run R>
+    const char* sse2Find(const char* p, const char* end, int& lines) {
+        while (end - p >= 16) {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            std::uint32_t stop = sse2StopMask<R>(v);
+            if constexpr (countsLines<R>()) {
+                auto nl = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+                lines += std::popcount(stop ? nl & beforeFirst(stop) : nl);
+            }
+            if (stop) return p + std::countr_zero(stop);
+            p += 16;
+        }
+        return scalarFind<R>(p, end, lines);
+    }
+
+    const char* sse2CommentEnd(const char* p, const char* end, int& lines) {
+        while (end - p >= 17) {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            auto next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+            auto hit = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('*')), _mm_cmpeq_epi8(next, _mm_set1_epi8('/'))
+            )));
+            auto nl = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+            if (hit) {
+                lines += std::popcount(nl & beforeFirst(hit));
+                return p + std::countr_zero(hit);
+            }
+            lines += std::popcount(nl);
+            p += 16;
+        }
+        return scalarCommentEnd(p, end, lines);
+    }
+
+    template <Run R>
+    YHS_TARGET_AVX2 inline std::uint32_t avx2StopMask(__m256i v) {
+        if constexpr (R == Run::Whitespace) {
+            auto ws = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')))
+            );
+            return ~static_cast<std::uint32_t>(_mm256_movemask_epi8(ws));
+        } else if constexpr (R == Run::LineEnd) {
+            return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        } else if constexpr (R == Run::Identifier) {
+            auto x = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+            auto letter = _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(25)), x);
+            return ~static_cast<std::uint32_t>(_mm256_movemask_epi8(letter));
+        } else if constexpr (R == Run::Digits) {
+            auto x = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+            auto digit = _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(9)), x);
+            return ~static_cast<std::uint32_t>(_mm256_movemask_epi8(digit));
+        } else {
+            auto stop = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+            return static_cast<std::uint32_t>(_mm256_movemask_epi8(stop));
+        }
+    }
+
+    template <Run R>
+    YHS_TARGET_AVX2 const char* avx2Find(const char* p, const char* end, int& lines) {
+        while (end - p >= 32) {
+            auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            std::uint32_t stop = avx2StopMask<R>(v);
+            if constexpr (countsLines<R>()) {
+                auto nl = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+                lines += std::popcount(stop ? nl & beforeFirst(stop) : nl);
+            }
+            if (stop) return p + std::countr_zero(stop);
+            p += 32;
+        }
+        return sse2Find<R>(p, end, lines);
+    }
+
+    YHS_TARGET_AVX2 const char* avx2CommentEnd(const char* p, const char* end, int& lines) {
+        while (end - p >= 33) {
+            auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            auto next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+            auto hit = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')), _mm256_cmpeq_epi8(next, _mm256_set1_epi8('/'))
+            )));
+            auto nl = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+            if (hit) {
+                lines += std::popcount(nl & beforeFirst(hit));
+                return p + std::countr_zero(hit);
+            }
+            lines += std::popcount(nl);
+            p += 32;
+        }
+        return sse2CommentEnd(p, end, lines);
+    }
+
+    bool cpuHasAvx2() {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    #else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }
+
+    const scan::Kernels sse2Kernels = {
+        "sse2",
+        sse2Find<Run::Whitespace>,
+        sse2Find<Run::LineEnd>,
+        sse2CommentEnd,
+        sse2Find<Run::Identifier>,
+        sse2Find<Run::Digits>,
+        sse2Find<Run::StringStop>
+    };
+
+    const scan::Kernels avx2Kernels = {
+        "avx2",
+        avx2Find<Run::Whitespace>,
+        avx2Find<Run::LineEnd>,
+        avx2CommentEnd,
+        avx2Find<Run::Identifier>,
+        avx2Find<Run::Digits>,
+        avx2Find<Run::StringStop>
+    };
+#endif
+
+    const scan::Kernels scalarKernels = {
+        "scalar",
+        scalarFind<Run::Whitespace>,
+        scalarFind<Run::LineEnd>,
+        scalarCommentEnd,
+        scalarFind<Run::Identifier>,
+        scalarFind<Run::Digits>,
+        scalarFind<Run::StringStop>
+    };
+
+    const scan::Kernels* detect() {
+    #ifdef YHS_SCAN_X86
+        return cpuHasAvx2() ? &avx2Kernels : &sse2Kernels;
+    #else
+        return &scalarKernels;
+    #endif
+    }
+
+    bool scalarForced = false;
+}
+
+const scan::Kernels& scan::kernels() {
+    static const Kernels* best = detect();
+    return scalarForced ? scalarKernels : *best;
+}
+
+void scan::forceScalar(bool scalar) {
+    scalarForced = scalar;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+// byte scanning kernels used by the lexer for the long runs (whitespace, comments, identifiers, strings).
+// there's an sse2 and avx2 version on x86-64 picked at runtime, everything else gets the scalar one.
+namespace frontend {
+    namespace scan {
+        // every kernel returns the first byte in [begin, end) that stops the run (or end),
+        // kernels that can walk over newlines add them to lines.
+        using ScanFn = const char* (*)(const char* begin, const char* end, int& lines);
+
+        struct Kernels {
+            const char* name;
+            ScanFn skipWhitespace; // first byte that isnt ' ', \t, \r or \n
+            ScanFn findLineEnd; // first \n
+            ScanFn findCommentEnd; // the '*' of the first "*/"
+            ScanFn scanIdentifier; // first byte that isnt a letter
+            ScanFn scanDigits; // first byte that isnt 0-9
+            ScanFn findStringStop; // first '"' or '\'
+        };
+
+        const Kernels& kernels();
+
+        // forces the scalar kernels, so the simd paths can be checked against them.
+        void forceScalar(bool scalar);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "symbols.hpp"
+#include <deque>
+#include <unordered_map>
+
+using namespace frontend;
+
+namespace {
+    // deque so the names dont move around, the map keys are views into them.
+    struct Table {
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, SymbolId> ids;
+    };
+
+    Table& table() {
+        static Table instance;
+        return instance;
+    }
+}
+
+SymbolId Symbols::intern(std::string_view name) {
+    auto& symbols = table();
+    auto it = symbols.ids.find(name);
+    if (it != symbols.ids.end()) {
+        return it->second;
+    }
+
+    auto id = static_cast<SymbolId>(symbols.names.size());
+    symbols.names.emplace_back(name);
+    symbols.ids.emplace(symbols.names.back(), id);
+    return id;
+}
+
+const std::string& Symbols::name(SymbolId id) {
+    return table().names[id];
+}
+
+std::size_t Symbols::count() {
+    return table().names.size();
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace frontend {
+    using SymbolId = std::uint32_t;
+
+    // global intern table for identifier names, the lexer interns every identifier once
+    // and everything after it (AST, environments, objects) only passes the id around.
+    class Symbols {
+    public:
+        Symbols() = delete;
+
+        static SymbolId intern(std::string_view name);
+        static const std::string& name(SymbolId id);
+        static std::size_t count();
+    };
+}
\ No newline at end of file
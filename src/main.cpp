@@ -1,10 +1,21 @@
 #include <iostream>
 #include <fstream>
+#include <chrono>
 #include "frontend/lexer.hpp"
 #include "frontend/parser.hpp"
+#include "frontend/scan.hpp"
+#include "frontend/flat_ast.hpp"
+#include "frontend/cache.hpp"
+#include "frontend/resolver.hpp"
+#include "frontend/optimizer.hpp"
+#include "frontend/ast_printer.hpp"
+#include "runtime/compiler.hpp"
+#include "runtime/vm.hpp"
+#include "runtime/closure.hpp"
 #include "runtime/interpreter.hpp"
 #include "runtime/values.hpp"
 #include "runtime/environment.hpp"
+#include "runtime/heap.hpp"
 #include <rift.hpp>
 #include <fmt/core.h>
 
@@ -26,7 +37,7 @@ std::string constructProgramStr(frontend::AST::Program* program) {
                 auto num = dynamic_cast<AST::Identifier*>(stmt);
                 body += rift::format("      [kind: {kind}, value: {value}]\n", {
                     {"kind", rift::Value::from(static_cast<int>(stmt->kind))},
-                    {"value", rift::Value::from(num->symbol)}
+                    {"value", rift::Value::from(Symbols::name(num->symbol))}
                 });
                 break;
             }
@@ -36,7 +47,7 @@ std::string constructProgramStr(frontend::AST::Program* program) {
                     {"kind", rift::Value::from(static_cast<int>(stmt->kind))},
                     {"left", rift::Value::from(dynamic_cast<AST::NumericLiteral*>(num->left)->value)},
                     {"right", rift::Value::from(dynamic_cast<AST::NumericLiteral*>(num->right)->value)},
-                    {"operator", rift::Value::from(num->op)}
+                    {"operator", rift::Value::from(std::string(AST::opText(num->op)))}
                 });
                 break;
             }
@@ -46,6 +57,26 @@ std::string constructProgramStr(frontend::AST::Program* program) {
     return body;
 }
 
+// node counts and sizes for one parse, so AST memory per MB of source can be tracked.
+void printAstStats(frontend::AST::Program* program, std::size_t sourceSize) {
+    std::size_t nodeBytes = 0;
+    fmt::print("{:<20} {:>10} {:>8} {:>12}\n", "node", "count", "sizeof", "bytes");
+    for (std::size_t i = 0; i < AST::NODE_TYPE_COUNT; ++i) {
+        auto type = static_cast<AST::NodeType>(i);
+        auto count = program->nodeCounts[i];
+        if (count == 0) continue;
+        nodeBytes += count * AST::nodeSize(type);
+        fmt::print("{:<20} {:>10} {:>8} {:>12}\n", AST::nodeName(type), count, AST::nodeSize(type), count * AST::nodeSize(type));
+    }
+
+    auto used = program->arena->bytesUsed();
+    double megabytes = sourceSize / (1024.0 * 1024.0);
+    fmt::print("nodes: {} bytes, lists: {} bytes, arena: {} used / {} reserved\n", nodeBytes, used - nodeBytes, used, program->arena->bytesReserved());
+    if (megabytes > 0) {
+        fmt::print("{:.0f} arena bytes per MB of source\n", used / megabytes);
+    }
+}
+
 std::string createThing(const std::string& str) {
     std::string thing;
     bool first = true;
@@ -61,11 +92,53 @@ std::string createThing(const std::string& str) {
 
 int main(int argc, const char* argv[]) {
     auto lex = new frontend::Lexer();
-    if (argc < 2) {
+    std::string filePath;
+    bool astStats = false;
+    bool timings = false;
+    bool useCache = true;
+    bool compileOnly = false;
+    bool dumpAst = false;
+    bool gcStats = false;
+    std::string engine = "ast";
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--scalar-lexer") {
+            frontend::scan::forceScalar(true); // handy for checking the simd lexer against the plain one
+        } else if (arg == "--ast-stats") {
+            astStats = true;
+        } else if (arg == "--time") {
+            timings = true; // phase timings go to stderr, for comparing engines
+        } else if (arg == "--no-cache") {
+            useCache = false;
+        } else if (arg == "--compile") {
+            compileOnly = true; // just writes the .yhsc next to the script
+        } else if (arg == "--dump-ast") {
+            dumpAst = true; // prints the tree before and after the optimizer, then stops
+        } else if (arg == "--gc-stats") {
+            gcStats = true; // collector totals go to stderr once the script is done
+        } else if (arg.starts_with("--gc-pause=")) {
+            runtime::Heap::setPauseTarget(std::atof(std::string(arg.substr(11)).c_str())); // ms per collector step, 0 stops the world
+        } else if (arg.starts_with("--engine=")) {
+            engine = arg.substr(9);
+        } else {
+            filePath = arg;
+        }
+    }
+    if (filePath.empty()) {
         std::cout << "Missing argument: <yhs file>" << std::endl;
         return 1;
     }
-    auto source = utils::readFile(argv[1]);
+    if (engine != "ast" && engine != "flat" && engine != "vm" && engine != "closure") {
+        std::cout << "Unknown engine: " << engine << " (expected ast, flat, vm or closure)" << std::endl;
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto elapsed = [](Clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+    };
+    auto start = Clock::now();
+    auto source = utils::readFile(filePath);
 
     auto parser = new frontend::Parser();
 
@@ -75,17 +148,119 @@ int main(int argc, const char* argv[]) {
     auto interpreter = new runtime::interpreter();
     try {
         ///*
-        auto program = parser->produceAST(source);
-        auto evaluated = interpreter->evaluate(program, env);
+        // scripts are cached as their FlatAST in a .yhsc next to them, keyed by a hash of the source.
+        auto cachePath = frontend::ScriptCache::pathFor(filePath);
+        bool cacheable = (useCache || compileOnly) && filePath != "-";
+        std::optional<frontend::FlatAST> flat;
+        std::unique_ptr<frontend::AST::Program> program;
+
+        if (cacheable && !compileOnly && !dumpAst) {
+            flat = frontend::ScriptCache::load(cachePath, source->contents);
+            if (timings) fmt::print(stderr, "cache {}: {:.3f} ms\n", flat ? "hit" : "miss", elapsed(start));
+        }
+
+        if (!flat) {
+            start = Clock::now();
+            program = parser->produceAST(source.get());
+            if (timings) fmt::print(stderr, "parse: {:.3f} ms\n", elapsed(start));
+
+            // variables are resolved to slots once, before anything gets cached or run.
+            start = Clock::now();
+            frontend::Resolver::resolve(program.get(), env->slotNames());
+            if (timings) fmt::print(stderr, "resolve: {:.3f} ms\n", elapsed(start));
+
+            if (dumpAst) fmt::print("before:\n{}", frontend::AstPrinter::print(program.get()));
+            start = Clock::now();
+            frontend::Optimizer::optimize(program.get());
+            if (timings) fmt::print(stderr, "optimize: {:.3f} ms\n", elapsed(start));
+            if (dumpAst) {
+                fmt::print("after:\n{}", frontend::AstPrinter::print(program.get()));
+                return 0;
+            }
+
+            if (cacheable) {
+                flat = frontend::FlatAST::fromProgram(program.get());
+                bool stored = frontend::ScriptCache::store(cachePath, *flat, source->contents);
+                if (compileOnly && !stored) {
+                    fmt::print("Couldn't write {}", cachePath);
+                    return 1;
+                }
+            }
+        }
+        if (compileOnly) {
+            return 0;
+        }
+
+        if (engine != "flat" || astStats) {
+            if (!program) {
+                start = Clock::now();
+                program = flat->toProgram();
+                if (timings) fmt::print(stderr, "rebuild: {:.3f} ms\n", elapsed(start));
+            }
+            if (astStats) {
+                printAstStats(program.get(), source->contents.size());
+                return 0;
+            }
+        }
+
+        if (engine == "flat") {
+            if (!flat) {
+                start = Clock::now();
+                flat = frontend::FlatAST::fromProgram(program.get());
+                if (timings) fmt::print(stderr, "flatten: {:.3f} ms\n", elapsed(start));
+            }
+
+            start = Clock::now();
+            interpreter->evaluate(*flat, flat->root(), env);
+        } else if (engine == "vm") {
+            start = Clock::now();
+            auto module = runtime::Compiler::compile(program.get());
+            if (timings) fmt::print(stderr, "compile: {:.3f} ms\n", elapsed(start));
+
+            start = Clock::now();
+            runtime::VM vm;
+            vm.run(*module, env);
+        } else if (engine == "closure") {
+            start = Clock::now();
+            auto compiled = runtime::closure::compile(program.get());
+            if (timings) fmt::print(stderr, "compile: {:.3f} ms\n", elapsed(start));
+
+            start = Clock::now();
+            runtime::closure::execute(*compiled, env);
+        } else {
+            start = Clock::now();
+            interpreter->evaluate(program.get(), env);
+        }
+        if (timings) fmt::print(stderr, "run ({}): {:.3f} ms\n", engine, elapsed(start));
+        if (gcStats) {
+            auto& stats = runtime::Heap::stats();
+            fmt::print(stderr, "gc: {} collections in {} steps, {:.3f} ms total pause, {:.3f} ms max pause\n", stats.collections, stats.steps, stats.totalPauseMs, stats.maxPauseMs);
+            fmt::print(stderr, "gc: {} objects live ({} KB), {} KB peak, {} freed\n", stats.objects, stats.bytes / 1024, stats.peakBytes / 1024, stats.freedObjects);
+            std::string histogram;
+            for (std::size_t i = 0; i < stats.pauses.size(); ++i) {
+                if (i < runtime::Heap::PAUSE_BUCKETS.size()) {
+                    histogram += fmt::format(" <{}ms: {}", runtime::Heap::PAUSE_BUCKETS[i], stats.pauses[i]);
+                } else {
+                    histogram += fmt::format(" longer: {}", stats.pauses[i]);
+                }
+            }
+            fmt::print(stderr, "gc pauses:{}\n", histogram);
+            for (std::size_t kind = 0; kind < runtime::Heap::KIND_COUNT; ++kind) {
+                if (stats.made[kind] == 0) continue; // null, numbers and booleans are never on the heap
+                fmt::print(stderr, "alloc {}: {} made, {} live\n", runtime::Heap::kindName(kind), stats.made[kind], stats.live[kind]);
+            }
+            fmt::print(stderr, "alloc: {} KB of slabs\n", runtime::SlabAllocator::reservedBytes() / 1024);
+        }
         //*/
         /*
         auto lexer = new Lexer();
-        auto tokens = lexer->tokenize(source->contents);
-        for (auto& token : tokens) {
+        auto stream = lexer->tokenize(source->contents);
+        for (auto& token : stream.tokens) {
+            auto value = std::string(stream.text(token));
             fmt::print("{}", rift::format("type: {type}, value: {value}\ndata values: {data_values}\n\n--------------\n", {
-                {"type", rift::Value::from(static_cast<int>(token->type))},
-                {"value", rift::Value::from(token->value)},
-                {"data_values", rift::Value::from(createThing(token->value))}
+                {"type", rift::Value::from(static_cast<int>(token.type))},
+                {"value", rift::Value::from(value)},
+                {"data_values", rift::Value::from(createThing(value))}
             }));
         }
         */
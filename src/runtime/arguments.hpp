@@ -0,0 +1,52 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "values.hpp"
+#include "heap.hpp"
+
+namespace runtime {
+    // the arguments of every call in progress, back to back in one buffer, so a call doesn't need a
+    // vector of its own. a call pushes its arguments through a Frame, which drops them again once the
+    // call is done (or throws). the collector traces it as a root.
+    class ArgumentStack {
+    public:
+        ArgumentStack() {
+            buffer.reserve(256);
+        }
+
+        class Frame {
+        public:
+            explicit Frame(ArgumentStack& stack) : stack(stack), base(stack.buffer.size()) {}
+            ~Frame() {
+                stack.buffer.resize(base);
+            }
+            Frame(const Frame&) = delete;
+            Frame& operator=(const Frame&) = delete;
+
+            void push(values::Value value) {
+                stack.buffer.push_back(value);
+            }
+            void clear() {
+                stack.buffer.resize(base);
+            }
+            void set(std::size_t index, values::Value value) {
+                stack.buffer[base + index] = value;
+            }
+            // only good until something else gets pushed, so callees copy what they keep out of it first.
+            std::span<const values::Value> args() const {
+                return {stack.buffer.data() + base, stack.buffer.size() - base};
+            }
+        private:
+            ArgumentStack& stack;
+            std::size_t base;
+        };
+
+        void trace(Tracer& tracer) const {
+            for (auto value : buffer) {
+                tracer.mark(value);
+            }
+        }
+    private:
+        std::vector<values::Value> buffer;
+    };
+}
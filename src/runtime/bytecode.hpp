@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "values.hpp"
+
+// what the vm runs. code is a byte stream, an opcode followed by its operands, operands are 32 bits
+// unless noted and stored unaligned in native byte order (the bytecode is never written to disk).
+namespace runtime {
+    namespace bytecode {
+        enum class Op : std::uint8_t {
+            Constant, // index: push constants[index]
+            Null, // push null
+            Pop, // drop the top
+            Replace, // drop the value under the top, blocks use it to keep only their last statement's value
+
+            GetVar, // depth, slot: as given by the resolver
+            SetVar, // depth, slot: assigns the top, leaves it there
+            DeclareVar, // slot: declares the top in the current scope, leaves it there
+            DeclareConst, // slot
+
+            NewObject, // push an empty object
+            SetProperty, // symbol: pops the value, sets it on the object under it
+            GetMember, // symbol, site: replaces the object on top with the property, site is its inline cache
+
+            Add, Sub, Mul, Div, Mod,
+            Less, Greater, Equal, GreaterEqual, LessEqual,
+
+            Jump, // offset, signed and relative to the end of the instruction
+            JumpIfFalse, // offset: pops the condition
+            Closure, // function index: push a function value bound to the current scope
+            Call, // argument count: the callee is on top with the arguments under it
+            TailCall, // argument count: same as Call, but a script function takes over the current frame
+            Return // returns the top to the caller
+        };
+
+        struct Function {
+            frontend::SymbolId name = 0;
+            std::uint32_t paramCount = 0;
+            bool captured = false; // calls get a heap scope, see FunValue
+            std::vector<frontend::SymbolId> locals; // slot names of a call's scope, params first
+            std::vector<std::uint8_t> code;
+        };
+
+        // everything one program compiles to. functions[0] is the top level code.
+        struct Module {
+            std::vector<values::Value> constants;
+            std::vector<std::unique_ptr<Function>> functions;
+            std::vector<frontend::SymbolId> globals;
+            std::uint32_t memberSites = 0; // how many inline caches GetMember uses
+
+            const Function& main() const {
+                return *functions[0];
+            }
+        };
+
+        inline std::uint32_t readOperand(const std::uint8_t* at) {
+            std::uint32_t operand;
+            std::memcpy(&operand, at, sizeof(operand));
+            return operand;
+        }
+
+        inline constexpr std::size_t OPERAND_SIZE = sizeof(std::uint32_t);
+    }
+}
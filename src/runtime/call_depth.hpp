@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <fmt/core.h>
+
+namespace runtime {
+    // how deep script calls can nest, in every engine. tail calls don't count, they replace the call
+    // they're made from.
+    inline constexpr std::uint32_t MAX_CALL_DEPTH = 3000;
+
+    // how much of the C++ stack the engines that recurse on it may use, out of the 8 MB Linux and macOS
+    // give the main thread (and CMakeLists.txt asks MSVC for). what a call takes depends on how deeply
+    // its body is nested and on the build, an unoptimized walker takes several KB a level, so counting
+    // calls alone can't keep them off the end of it. the rest is slack for whatever runs between two
+    // checks and for unwinding the error.
+    inline constexpr std::size_t STACK_BUDGET = 6 * 1024 * 1024;
+
+    [[noreturn]] inline void callDepthExceeded() {
+        throw std::runtime_error(fmt::format("Maximum call depth of {} exceeded.", MAX_CALL_DEPTH));
+    }
+
+    // about where the C++ stack is right now.
+    inline std::uintptr_t stackPosition() {
+        char marker;
+        return reinterpret_cast<std::uintptr_t>(&marker);
+    }
+
+    // how far an engine has gone down the C++ stack since it was entered. it's a call depth error once
+    // that passes STACK_BUDGET, whatever the count of calls is.
+    class StackLimit {
+    public:
+        void enter() {
+            base = stackPosition();
+        }
+        void check() const {
+            auto here = stackPosition();
+            auto used = here < base ? base - here : here - base;
+            if (used > STACK_BUDGET) [[unlikely]] callDepthExceeded();
+        }
+    private:
+        std::uintptr_t base = stackPosition();
+    };
+
+    // counts one call for as long as it's in scope.
+    class CallDepth {
+    public:
+        CallDepth(std::uint32_t& depth, const StackLimit& stack) : depth(depth) {
+            if (depth >= MAX_CALL_DEPTH) callDepthExceeded();
+            stack.check();
+            ++depth;
+        }
+        ~CallDepth() {
+            --depth;
+        }
+        CallDepth(const CallDepth&) = delete;
+        CallDepth& operator=(const CallDepth&) = delete;
+    private:
+        std::uint32_t& depth;
+    };
+}
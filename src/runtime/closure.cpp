@@ -0,0 +1,549 @@
+#include "closure.hpp"
+#include <stdexcept>
+#include <vector>
+#include "arguments.hpp"
+#include "call_depth.hpp"
+#include "environment.hpp"
+#include "heap.hpp"
+#include "interpreter.hpp"
+#include "numbers.hpp"
+#include "../utils.hpp"
+
+using namespace runtime;
+using namespace frontend;
+using closure::Code;
+
+namespace {
+    struct ConstantCode : Code {
+        values::Value value;
+    };
+
+    struct VariableCode : Code {
+        std::uint32_t depth;
+        std::uint32_t slot;
+    };
+
+    struct BinaryCode : Code {
+        const Code* left;
+        const Code* right;
+    };
+
+    struct DeclareCode : Code {
+        std::uint32_t slot;
+        bool constant;
+        const Code* value; // null declares null
+    };
+
+    struct AssignCode : Code {
+        std::uint32_t depth;
+        std::uint32_t slot;
+        const Code* value;
+    };
+
+    struct ObjectCode : Code {
+        AST::List<SymbolId> keys;
+        AST::List<const Code*> values;
+    };
+
+    struct MemberCode : Code {
+        const Code* object;
+        SymbolId symbol;
+        mutable PropertyCache cache;
+    };
+
+    struct CallCode : Code {
+        const Code* callee;
+        AST::List<const Code*> args;
+    };
+
+    struct FunctionCode : Code {
+        SymbolId name;
+        std::uint32_t slot;
+        AST::List<SymbolId> params;
+        AST::List<SymbolId> locals;
+        const Code* body;
+        bool captured;
+    };
+
+    struct IfCode : Code {
+        const Code* condition;
+        const Code* body;
+        const Code* elseBody; // null without an else
+    };
+
+    struct WhileCode : Code {
+        const Code* condition;
+        AST::List<const Code*> body;
+    };
+
+    struct BlockCode : Code {
+        AST::List<const Code*> body;
+    };
+
+    struct ReturnCode : Code {
+        const Code* value; // null returns null
+    };
+
+    ArgumentStack arguments;
+    ArgumentStack pinned; // values only C++ locals hold, apart from arguments since tail calls rewrite those
+    CallStack calls;
+    std::uint32_t callDepth = 0;
+    StackLimit stack; // entered by execute()
+
+    // what the collector needs from a running program, the constants are rooted when they're made.
+    struct Roots : RootSource {
+        void traceRoots(Tracer& tracer) override {
+            arguments.trace(tracer);
+            pinned.trace(tracer);
+            calls.trace(tracer);
+        }
+    };
+
+    // same completion signal as the walker: blocks stop at anything but Normal and hand it up.
+    Completion completion = Completion::Normal;
+
+    // the script call in progress. a tail call leaves its arguments in the call's frame and returns its
+    // callee with Completion::TailCall, and the call loops instead of recursing.
+    struct ScriptCall {
+        explicit ScriptCall(ArgumentStack::Frame& frame) : frame(frame), outer(current) {
+            current = this;
+        }
+        ~ScriptCall() {
+            current = outer;
+        }
+
+        ArgumentStack::Frame& frame;
+        ScriptCall* outer;
+
+        static inline ScriptCall* current = nullptr;
+    };
+
+    template <typename T>
+    const T* as(const Code* code) {
+        return static_cast<const T*>(code);
+    }
+
+    values::Value runConstant(const Code* self, Environment*) {
+        return as<ConstantCode>(self)->value;
+    }
+
+    values::Value runVariable(const Code* self, Environment* env) {
+        auto code = as<VariableCode>(self);
+        return env->lookupAt(code->depth, code->slot);
+    }
+
+    template <AST::BinaryOp OP>
+    values::Value runBinary(const Code* self, Environment* env) {
+        auto code = as<BinaryCode>(self);
+        auto lhs = (*code->left)(env);
+        values::Value rhs;
+        if (lhs.isObject()) {
+            // a string, it has to outlive the right side.
+            ArgumentStack::Frame pin(pinned);
+            pin.push(lhs);
+            rhs = (*code->right)(env);
+        } else {
+            rhs = (*code->right)(env);
+        }
+        if (lhs.isNumber() && rhs.isNumber()) {
+            return values::Value::number(numbers::arithmetic<OP>(lhs.asNumber(), rhs.asNumber()));
+        }
+        return interpreter::apply_binary(lhs, rhs, OP);
+    }
+
+    template <AST::CompareOp OP>
+    values::Value runCompare(const Code* self, Environment* env) {
+        auto code = as<BinaryCode>(self);
+        auto lhs = (*code->left)(env);
+        values::Value rhs;
+        if (lhs.isObject()) {
+            // compared by identity, it has to outlive the right side.
+            ArgumentStack::Frame pin(pinned);
+            pin.push(lhs);
+            rhs = (*code->right)(env);
+        } else {
+            rhs = (*code->right)(env);
+        }
+        if (lhs.isNumber() && rhs.isNumber()) {
+            return values::Value::boolean(numbers::compare<OP>(lhs.asNumber(), rhs.asNumber()));
+        }
+        return interpreter::apply_comparison(lhs, rhs, OP);
+    }
+
+    values::Value runDeclare(const Code* self, Environment* env) {
+        auto code = as<DeclareCode>(self);
+        auto value = code->value ? (*code->value)(env) : values::Value::null();
+        return env->declareAt(code->slot, value, code->constant);
+    }
+
+    values::Value runAssign(const Code* self, Environment* env) {
+        auto code = as<AssignCode>(self);
+        return env->assignAt(code->depth, code->slot, (*code->value)(env));
+    }
+
+    values::Value runObject(const Code* self, Environment* env) {
+        auto code = as<ObjectCode>(self);
+        auto object = Heap::make<values::ObjectVal>();
+        object->reserve(code->keys.count);
+        ArgumentStack::Frame pin(pinned);
+        pin.push(values::Value::object(object));
+        for (std::size_t i = 0; i < code->keys.size(); ++i) {
+            object->define(code->keys[i], (*code->values[i])(env));
+        }
+        return values::Value::object(object);
+    }
+
+    values::Value runMember(const Code* self, Environment* env) {
+        auto code = as<MemberCode>(self);
+        return interpreter::access_member((*code->object)(env), code->symbol, code->cache);
+    }
+
+    values::Value callNative(values::Value callee, std::span<const values::Value> args, Environment* env) {
+        if (callee.type() == values::ValueType::NativeFn) {
+            return callee.as<values::NativeFnValue>()->call(args, env);
+        }
+        throw std::runtime_error("Interpreter: Cannot call value that is not a function.");
+    }
+
+    values::Value runCall(const Code* self, Environment* env) {
+        auto code = as<CallCode>(self);
+        ArgumentStack::Frame frame(arguments);
+        for (auto arg : code->args) {
+            frame.push((*arg)(env));
+        }
+        auto callee = (*code->callee)(env);
+        if (callee.type() != values::ValueType::Function) {
+            return callNative(callee, frame.args(), env);
+        }
+
+        CallDepth depth(callDepth, stack);
+        ScriptCall call(frame);
+        Environment stackScope(nullptr);
+        CallStack::Entry rooted(calls, callee, &stackScope);
+        while (true) {
+            // same as the vm, a fresh scope per call and missing arguments are null. captured functions
+            // get theirs from the heap.
+            auto fn = callee.as<values::FunValue>();
+            Environment* scope = &stackScope;
+            rooted.set(callee, scope);
+            if (fn->captured) {
+                scope = Heap::make<Environment>(fn->decEnv, fn->locals);
+                rooted.set(callee, scope);
+            } else {
+                stackScope.reset(fn->decEnv, fn->locals);
+            }
+            auto args = frame.args();
+            for (std::uint32_t i = 0; i < fn->params.size(); ++i) {
+                scope->declareAt(i, i < args.size() ? args[i] : values::Value::null(), false);
+            }
+
+            auto result = (*fn->closureBody)(scope);
+            if (completion != Completion::TailCall) {
+                completion = Completion::Normal; // a return, or nothing
+                return result;
+            }
+            completion = Completion::Normal;
+            callee = result;
+        }
+    }
+
+    // only bound for calls the resolver marked as tail calls, which are always inside a runCall.
+    values::Value runTailCall(const Code* self, Environment* env) {
+        auto code = as<CallCode>(self);
+        auto call = ScriptCall::current;
+        call->frame.clear(); // the current arguments are already in their slots
+        for (auto arg : code->args) {
+            call->frame.push((*arg)(env));
+        }
+        auto callee = (*code->callee)(env);
+        if (callee.type() != values::ValueType::Function) {
+            return callNative(callee, call->frame.args(), env);
+        }
+
+        completion = Completion::TailCall;
+        return callee;
+    }
+
+    values::Value runFunction(const Code* self, Environment* env) {
+        auto code = as<FunctionCode>(self);
+        auto fn = Heap::make<values::FunValue>();
+        fn->name = code->name;
+        fn->params = code->params;
+        fn->locals = code->locals;
+        fn->decEnv = env;
+        fn->closureBody = code->body;
+        fn->captured = code->captured;
+        return env->declareAt(code->slot, values::Value::object(fn), true);
+    }
+
+    values::Value runIf(const Code* self, Environment* env) {
+        auto code = as<IfCode>(self);
+        if (interpreter::is_true((*code->condition)(env))) {
+            return (*code->body)(env);
+        }
+        return code->elseBody ? (*code->elseBody)(env) : values::Value::null();
+    }
+
+    values::Value runWhile(const Code* self, Environment* env) {
+        auto code = as<WhileCode>(self);
+        values::Value lastEvaluated;
+        ArgumentStack::Frame pin(pinned); // lastEvaluated, kept across the next condition
+        pin.push(lastEvaluated);
+        while (interpreter::is_true((*code->condition)(env))) {
+            for (auto stmt : code->body) {
+                auto value = (*stmt)(env);
+                if (completion != Completion::Normal) {
+                    if (completion == Completion::Return || completion == Completion::TailCall) {
+                        return value;
+                    }
+                    break;
+                }
+                lastEvaluated = value;
+                pin.set(0, value);
+            }
+
+            if (completion == Completion::Break) {
+                completion = Completion::Normal;
+                break;
+            }
+            completion = Completion::Normal;
+        }
+        return lastEvaluated;
+    }
+
+    values::Value runBreak(const Code*, Environment*) {
+        completion = Completion::Break;
+        return values::Value::null();
+    }
+
+    values::Value runContinue(const Code*, Environment*) {
+        completion = Completion::Continue;
+        return values::Value::null();
+    }
+
+    values::Value runReturn(const Code* self, Environment* env) {
+        auto code = as<ReturnCode>(self);
+        auto value = code->value ? (*code->value)(env) : values::Value::null();
+        if (completion == Completion::Normal) {
+            completion = Completion::Return; // otherwise it was a tail call, which already says where to go
+        }
+        return value;
+    }
+
+    values::Value runBlock(const Code* self, Environment* env) {
+        values::Value lastEvaluated;
+        for (auto stmt : as<BlockCode>(self)->body) {
+            lastEvaluated = (*stmt)(env);
+            if (completion != Completion::Normal) break;
+        }
+        return lastEvaluated;
+    }
+
+    Code::Run binaryKernel(AST::BinaryOp op) {
+        switch (op) {
+            case AST::BinaryOp::Add: return runBinary<AST::BinaryOp::Add>;
+            case AST::BinaryOp::Sub: return runBinary<AST::BinaryOp::Sub>;
+            case AST::BinaryOp::Mul: return runBinary<AST::BinaryOp::Mul>;
+            case AST::BinaryOp::Div: return runBinary<AST::BinaryOp::Div>;
+            case AST::BinaryOp::Mod: return runBinary<AST::BinaryOp::Mod>;
+        }
+        return nullptr;
+    }
+
+    Code::Run compareKernel(AST::CompareOp op) {
+        switch (op) {
+            case AST::CompareOp::Less: return runCompare<AST::CompareOp::Less>;
+            case AST::CompareOp::Greater: return runCompare<AST::CompareOp::Greater>;
+            case AST::CompareOp::Equal: return runCompare<AST::CompareOp::Equal>;
+            case AST::CompareOp::GreaterEqual: return runCompare<AST::CompareOp::GreaterEqual>;
+            case AST::CompareOp::LessEqual: return runCompare<AST::CompareOp::LessEqual>;
+        }
+        return nullptr;
+    }
+
+    class Binder {
+    public:
+        explicit Binder(AstArena& arena) : arena(arena) {}
+
+        template <typename T>
+        T* make(Code::Run run) {
+            auto code = arena.make<T>();
+            code->run = run;
+            return code;
+        }
+
+        template <typename T>
+        AST::List<T> list(const std::vector<T>& items) {
+            AST::List<T> result;
+            result.count = static_cast<std::uint32_t>(items.size());
+            if (!items.empty()) {
+                result.items = static_cast<T*>(arena.allocate(sizeof(T) * items.size(), alignof(T)));
+                std::copy(items.begin(), items.end(), result.items);
+            }
+            return result;
+        }
+
+        AST::List<const Code*> bindAll(const AST::List<AST::Stmt*>& stmts) {
+            std::vector<const Code*> codes;
+            codes.reserve(stmts.size());
+            for (auto stmt : stmts) {
+                codes.push_back(bind(stmt));
+            }
+            return list(codes);
+        }
+
+        const Code* block(const AST::List<AST::Stmt*>& stmts) {
+            auto code = make<BlockCode>(runBlock);
+            code->body = bindAll(stmts);
+            return code;
+        }
+
+        const Code* bind(AST::Stmt* stmt) {
+            switch (stmt->kind) {
+                case AST::NodeType::NumericLiteral: {
+                    auto code = make<ConstantCode>(runConstant);
+                    code->value = values::Value::number(static_cast<AST::NumericLiteral*>(stmt)->value);
+                    return code;
+                }
+                case AST::NodeType::StringLiteral: {
+                    auto code = make<ConstantCode>(runConstant);
+                    code->value = utils::MK_STRING_LITERAL(static_cast<AST::StringLiteral*>(stmt)->value);
+                    Heap::addRoot(code->value.asObject()); // lives as long as the program, which is the rest of the run
+                    return code;
+                }
+                case AST::NodeType::Identifier: {
+                    auto ident = static_cast<AST::Identifier*>(stmt);
+                    auto code = make<VariableCode>(runVariable);
+                    code->depth = ident->depth;
+                    code->slot = ident->slot;
+                    return code;
+                }
+                case AST::NodeType::BinaryExpr: {
+                    auto binop = static_cast<AST::BinEx*>(stmt);
+                    auto code = make<BinaryCode>(binaryKernel(binop->op));
+                    code->left = bind(binop->left);
+                    code->right = bind(binop->right);
+                    return code;
+                }
+                case AST::NodeType::CompExpr: {
+                    auto compEx = static_cast<AST::CompEx*>(stmt);
+                    auto code = make<BinaryCode>(compareKernel(compEx->op));
+                    code->left = bind(compEx->left);
+                    code->right = bind(compEx->right);
+                    return code;
+                }
+                case AST::NodeType::VarDeclare: {
+                    auto declaration = static_cast<AST::VarDeclare*>(stmt);
+                    auto code = make<DeclareCode>(runDeclare);
+                    code->slot = declaration->slot;
+                    code->constant = declaration->constant;
+                    code->value = declaration->value ? bind(declaration->value.value()) : nullptr;
+                    return code;
+                }
+                case AST::NodeType::AssignmentExpr: {
+                    auto assign = static_cast<AST::AssignExpr*>(stmt);
+                    if (assign->assigne->kind != AST::NodeType::Identifier) {
+                        throw std::runtime_error("Invalid LHS in assignment expression.");
+                    }
+                    auto ident = static_cast<AST::Identifier*>(assign->assigne);
+                    auto code = make<AssignCode>(runAssign);
+                    code->depth = ident->depth;
+                    code->slot = ident->slot;
+                    code->value = bind(assign->value);
+                    return code;
+                }
+                case AST::NodeType::ObjectLiteral: {
+                    std::vector<SymbolId> keys;
+                    std::vector<const Code*> values;
+                    for (auto prop : static_cast<AST::ObjectLiteral*>(stmt)->properties) {
+                        keys.push_back(prop->key);
+                        values.push_back(bind(prop->value.value())); // {a} comes out of the parser as {a: a}
+                    }
+                    auto code = make<ObjectCode>(runObject);
+                    code->keys = list(keys);
+                    code->values = list(values);
+                    return code;
+                }
+                case AST::NodeType::MemberExpr: {
+                    auto member = static_cast<AST::MemberExpr*>(stmt);
+                    if (member->property->kind != AST::NodeType::Identifier) {
+                        throw std::runtime_error("Interpreter: Property in member expression is not an identifier.");
+                    }
+                    auto code = make<MemberCode>(runMember);
+                    code->object = bind(member->object);
+                    code->symbol = static_cast<AST::Identifier*>(member->property)->symbol;
+                    return code;
+                }
+                case AST::NodeType::CallExpr: {
+                    auto call = static_cast<AST::CallExpr*>(stmt);
+                    std::vector<const Code*> args;
+                    for (auto arg : call->args) {
+                        args.push_back(bind(arg));
+                    }
+                    auto code = make<CallCode>(call->tail ? runTailCall : runCall);
+                    code->args = list(args);
+                    code->callee = bind(call->caller);
+                    return code;
+                }
+                case AST::NodeType::FunctionDeclaration: {
+                    auto declaration = static_cast<AST::FunDeclare*>(stmt);
+                    auto code = make<FunctionCode>(runFunction);
+                    code->name = declaration->name;
+                    code->slot = declaration->slot;
+                    code->params = declaration->parameters;
+                    code->locals = declaration->locals;
+                    code->body = block(declaration->body);
+                    code->captured = declaration->captured;
+                    return code;
+                }
+                case AST::NodeType::If: {
+                    auto ifstmt = static_cast<AST::IfStmt*>(stmt);
+                    auto code = make<IfCode>(runIf);
+                    code->condition = bind(ifstmt->condition);
+                    code->body = block(ifstmt->body);
+                    code->elseBody = ifstmt->elseStmt ? block(ifstmt->elseStmt.value()->body) : nullptr;
+                    return code;
+                }
+                case AST::NodeType::While: {
+                    auto whilestmt = static_cast<AST::WhileStmt*>(stmt);
+                    auto code = make<WhileCode>(runWhile);
+                    code->condition = bind(whilestmt->condition);
+                    code->body = bindAll(whilestmt->body);
+                    return code;
+                }
+                case AST::NodeType::BreakStmt: {
+                    return make<Code>(runBreak);
+                }
+                case AST::NodeType::ContinueStmt: {
+                    return make<Code>(runContinue);
+                }
+                case AST::NodeType::ReturnStmt: {
+                    auto returnstmt = static_cast<AST::ReturnStmt*>(stmt);
+                    auto code = make<ReturnCode>(runReturn);
+                    code->value = returnstmt->value ? bind(returnstmt->value.value()) : nullptr;
+                    return code;
+                }
+                default: {
+                    throw std::runtime_error("Interpreter: This AST has not been yet setup for interpretation.");
+                }
+            }
+        }
+    private:
+        AstArena& arena;
+    };
+}
+
+std::unique_ptr<closure::Program> closure::compile(AST::Program* program) {
+    auto compiled = std::make_unique<Program>();
+    Binder binder(compiled->arena);
+    compiled->body = binder.block(program->body);
+    compiled->globals = program->globals;
+    return compiled;
+}
+
+values::Value closure::execute(const Program& program, Environment* env) {
+    Roots roots;
+    stack.enter();
+    env->layout(program.globals);
+    return (*program.body)(env);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <memory>
+#include "values.hpp"
+#include "../frontend/arena.hpp"
+
+// closure compiled execution: the AST is walked once and every node becomes a Code, a function pointer
+// with its operands already bound (the + kernel of a BinEx, the branches of an if, ...). running the
+// program is then just calling into that tree, there's no switch on the node kind anymore.
+namespace runtime {
+    class Environment;
+
+    namespace closure {
+        struct Code {
+            using Run = values::Value (*)(const Code* self, Environment* env);
+            Run run;
+
+            values::Value operator()(Environment* env) const {
+                return run(this, env);
+            }
+        };
+
+        struct Program {
+            frontend::AstArena arena; // every Code lives in here
+            const Code* body = nullptr;
+            frontend::AST::List<frontend::SymbolId> globals; // points into the compiled AST's arena
+        };
+
+        std::unique_ptr<Program> compile(frontend::AST::Program* program);
+
+        values::Value execute(const Program& program, Environment* env);
+    }
+}
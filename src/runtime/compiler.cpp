@@ -0,0 +1,294 @@
+#include "compiler.hpp"
+#include <stdexcept>
+#include "heap.hpp"
+#include "../utils.hpp"
+
+using namespace runtime;
+using namespace frontend;
+using bytecode::Op;
+
+// binary and comparison opcodes are laid out in the same order as the AST's operator enums.
+static_assert(static_cast<int>(Op::Mod) - static_cast<int>(Op::Add) == static_cast<int>(AST::BinaryOp::Mod));
+static_assert(static_cast<int>(Op::LessEqual) - static_cast<int>(Op::Less) == static_cast<int>(AST::CompareOp::LessEqual));
+
+std::unique_ptr<bytecode::Module> Compiler::compile(AST::Program* program) {
+    auto module = std::make_unique<bytecode::Module>();
+    Compiler compiler;
+    compiler.module = module.get();
+
+    module->functions.push_back(std::make_unique<bytecode::Function>());
+    compiler.function = module->functions.back().get();
+    module->globals.assign(program->globals.begin(), program->globals.end());
+    compiler.block(program->body);
+    compiler.emit(Op::Return);
+
+    return module;
+}
+
+void Compiler::emit(Op op) {
+    function->code.push_back(static_cast<std::uint8_t>(op));
+}
+
+void Compiler::emit(Op op, std::uint32_t operand) {
+    emit(op);
+    auto at = function->code.size();
+    function->code.resize(at + bytecode::OPERAND_SIZE);
+    std::memcpy(function->code.data() + at, &operand, sizeof(operand));
+}
+
+void Compiler::emit(Op op, std::uint32_t first, std::uint32_t second) {
+    emit(op, first);
+    auto at = function->code.size();
+    function->code.resize(at + bytecode::OPERAND_SIZE);
+    std::memcpy(function->code.data() + at, &second, sizeof(second));
+}
+
+std::size_t Compiler::emitJump(Op op) {
+    emit(op, 0);
+    return function->code.size() - bytecode::OPERAND_SIZE;
+}
+
+void Compiler::patchJump(std::size_t at) {
+    auto offset = static_cast<std::int32_t>(function->code.size() - (at + bytecode::OPERAND_SIZE));
+    std::memcpy(function->code.data() + at, &offset, sizeof(offset));
+}
+
+void Compiler::emitJumpBack(std::size_t target) {
+    auto offset = static_cast<std::int32_t>(target) - static_cast<std::int32_t>(function->code.size() + 1 + bytecode::OPERAND_SIZE);
+    emit(Op::Jump, static_cast<std::uint32_t>(offset));
+}
+
+std::uint32_t Compiler::constant(values::Value value) {
+    // the module is kept for the rest of the run, so its strings are too.
+    if (value.isObject()) Heap::addRoot(value.asObject());
+    module->constants.push_back(value);
+    return static_cast<std::uint32_t>(module->constants.size() - 1);
+}
+
+// a block's value is its last statement's, an empty one is null.
+void Compiler::block(const AST::List<AST::Stmt*>& body) {
+    if (body.empty()) {
+        emit(Op::Null);
+        ++depth;
+        return;
+    }
+
+    bool first = true;
+    for (auto stmt : body) {
+        statement(stmt);
+        if (!first) {
+            emit(Op::Replace);
+            --depth;
+        }
+        first = false;
+    }
+}
+
+std::uint32_t Compiler::function_body(AST::FunDeclare* declaration) {
+    auto index = static_cast<std::uint32_t>(module->functions.size());
+    module->functions.push_back(std::make_unique<bytecode::Function>());
+    auto compiled = module->functions.back().get();
+    compiled->name = declaration->name;
+    compiled->paramCount = declaration->parameters.count;
+    compiled->captured = declaration->captured;
+    compiled->locals.assign(declaration->locals.begin(), declaration->locals.end());
+
+    auto outerFunction = function;
+    auto outerDepth = depth;
+    auto outerLoops = std::move(loops);
+    function = compiled;
+    depth = 0;
+    loops.clear();
+
+    block(declaration->body);
+    emit(Op::Return);
+
+    function = outerFunction;
+    depth = outerDepth;
+    loops = std::move(outerLoops);
+    return index;
+}
+
+void Compiler::statement(AST::Stmt* stmt) {
+    switch (stmt->kind) {
+        case AST::NodeType::NumericLiteral: {
+            auto value = static_cast<AST::NumericLiteral*>(stmt)->value;
+            auto it = numberConstants.find(value);
+            if (it == numberConstants.end()) {
+                it = numberConstants.emplace(value, constant(values::Value::number(value))).first;
+            }
+            emit(Op::Constant, it->second);
+            ++depth;
+            break;
+        }
+        case AST::NodeType::StringLiteral: {
+            // made once here, every evaluation of the literal pushes the same string.
+            emit(Op::Constant, constant(utils::MK_STRING_LITERAL(static_cast<AST::StringLiteral*>(stmt)->value)));
+            ++depth;
+            break;
+        }
+        case AST::NodeType::Identifier: {
+            auto ident = static_cast<AST::Identifier*>(stmt);
+            emit(Op::GetVar, ident->depth, ident->slot);
+            ++depth;
+            break;
+        }
+        case AST::NodeType::BinaryExpr: {
+            auto binop = static_cast<AST::BinEx*>(stmt);
+            statement(binop->left);
+            statement(binop->right);
+            emit(static_cast<Op>(static_cast<int>(Op::Add) + static_cast<int>(binop->op)));
+            --depth;
+            break;
+        }
+        case AST::NodeType::CompExpr: {
+            auto compEx = static_cast<AST::CompEx*>(stmt);
+            statement(compEx->left);
+            statement(compEx->right);
+            emit(static_cast<Op>(static_cast<int>(Op::Less) + static_cast<int>(compEx->op)));
+            --depth;
+            break;
+        }
+        case AST::NodeType::VarDeclare: {
+            auto declaration = static_cast<AST::VarDeclare*>(stmt);
+            if (declaration->value) {
+                statement(declaration->value.value());
+            } else {
+                emit(Op::Null);
+                ++depth;
+            }
+            emit(declaration->constant ? Op::DeclareConst : Op::DeclareVar, declaration->slot);
+            break;
+        }
+        case AST::NodeType::AssignmentExpr: {
+            auto assign = static_cast<AST::AssignExpr*>(stmt);
+            if (assign->assigne->kind != AST::NodeType::Identifier) {
+                throw std::runtime_error("Invalid LHS in assignment expression.");
+            }
+            statement(assign->value);
+            auto ident = static_cast<AST::Identifier*>(assign->assigne);
+            emit(Op::SetVar, ident->depth, ident->slot);
+            break;
+        }
+        case AST::NodeType::ObjectLiteral: {
+            emit(Op::NewObject);
+            ++depth;
+            for (auto prop : static_cast<AST::ObjectLiteral*>(stmt)->properties) {
+                statement(prop->value.value()); // {a} comes out of the parser as {a: a}
+                emit(Op::SetProperty, prop->key);
+                --depth;
+            }
+            break;
+        }
+        case AST::NodeType::MemberExpr: {
+            auto member = static_cast<AST::MemberExpr*>(stmt);
+            if (member->property->kind != AST::NodeType::Identifier) {
+                throw std::runtime_error("Interpreter: Property in member expression is not an identifier.");
+            }
+            statement(member->object);
+            emit(Op::GetMember, static_cast<AST::Identifier*>(member->property)->symbol, module->memberSites++);
+            break;
+        }
+        case AST::NodeType::CallExpr: {
+            // arguments go first so they're evaluated in the same order as the walker does it.
+            auto call = static_cast<AST::CallExpr*>(stmt);
+            for (auto arg : call->args) {
+                statement(arg);
+            }
+            statement(call->caller);
+            emit(call->tail ? Op::TailCall : Op::Call, call->args.count);
+            depth -= static_cast<int>(call->args.count);
+            break;
+        }
+        case AST::NodeType::FunctionDeclaration: {
+            auto declaration = static_cast<AST::FunDeclare*>(stmt);
+            emit(Op::Closure, function_body(declaration));
+            ++depth;
+            emit(Op::DeclareConst, declaration->slot);
+            break;
+        }
+        case AST::NodeType::If: {
+            auto ifstmt = static_cast<AST::IfStmt*>(stmt);
+            statement(ifstmt->condition);
+            auto toElse = emitJump(Op::JumpIfFalse);
+            --depth;
+
+            block(ifstmt->body);
+            auto toEnd = emitJump(Op::Jump);
+            --depth; // the other branch pushes its own value
+
+            patchJump(toElse);
+            if (ifstmt->elseStmt) {
+                block(ifstmt->elseStmt.value()->body);
+            } else {
+                emit(Op::Null);
+                ++depth;
+            }
+            patchJump(toEnd);
+            break;
+        }
+        case AST::NodeType::While: {
+            // the loop's value lives in one slot that every body statement replaces, so breaking out
+            // leaves the last finished statement's value there, the same as the walker.
+            auto whilestmt = static_cast<AST::WhileStmt*>(stmt);
+            emit(Op::Null);
+            ++depth;
+            auto start = function->code.size();
+            loops.push_back({depth, start, {}});
+
+            statement(whilestmt->condition);
+            auto toEnd = emitJump(Op::JumpIfFalse);
+            --depth;
+            for (auto body : whilestmt->body) {
+                statement(body);
+                emit(Op::Replace);
+                --depth;
+            }
+            emitJumpBack(start);
+
+            patchJump(toEnd);
+            for (auto at : loops.back().breaks) {
+                patchJump(at);
+            }
+            loops.pop_back();
+            break;
+        }
+        case AST::NodeType::BreakStmt: {
+            if (loops.empty()) {
+                throw std::runtime_error("Interpreter: break outside of a loop.");
+            }
+            for (int i = depth; i > loops.back().depth; --i) {
+                emit(Op::Pop);
+            }
+            loops.back().breaks.push_back(emitJump(Op::Jump));
+            ++depth; // never reached, but keeps the count right for whatever follows
+            break;
+        }
+        case AST::NodeType::ContinueStmt: {
+            if (loops.empty()) {
+                throw std::runtime_error("Interpreter: continue outside of a loop.");
+            }
+            for (int i = depth; i > loops.back().depth; --i) {
+                emit(Op::Pop);
+            }
+            emitJumpBack(loops.back().start);
+            ++depth;
+            break;
+        }
+        case AST::NodeType::ReturnStmt: {
+            // Return drops the whole frame, so whatever else is on the stack doesn't matter.
+            auto returnstmt = static_cast<AST::ReturnStmt*>(stmt);
+            if (returnstmt->value) {
+                statement(returnstmt->value.value());
+            } else {
+                emit(Op::Null);
+                ++depth;
+            }
+            emit(Op::Return);
+            break;
+        }
+        default: {
+            throw std::runtime_error("Interpreter: This AST has not been yet setup for interpretation.");
+        }
+    }
+}
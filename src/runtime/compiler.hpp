@@ -0,0 +1,41 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "bytecode.hpp"
+#include "../frontend/ast.hpp"
+
+namespace runtime {
+    // turns a parsed program into bytecode for the vm. every statement compiles to code that leaves
+    // exactly one value on the stack, so blocks, ifs, loops and calls give the same results as the walker.
+    class Compiler {
+    public:
+        static std::unique_ptr<bytecode::Module> compile(frontend::AST::Program* program);
+    private:
+        struct Loop {
+            int depth; // stack depth the loop's result sits at, break and continue pop back down to it
+            std::size_t start; // where the condition starts, continue jumps back there
+            std::vector<std::size_t> breaks;
+        };
+
+        bytecode::Module* module = nullptr;
+        bytecode::Function* function = nullptr;
+        // values on the stack above the current frame, only tracked so break knows how many to drop.
+        int depth = 0;
+        std::vector<Loop> loops;
+        std::unordered_map<int, std::uint32_t> numberConstants;
+
+        void emit(bytecode::Op op);
+        void emit(bytecode::Op op, std::uint32_t operand);
+        void emit(bytecode::Op op, std::uint32_t first, std::uint32_t second);
+        // emits a jump with a placeholder offset and returns where the offset goes.
+        std::size_t emitJump(bytecode::Op op);
+        void patchJump(std::size_t at);
+        void emitJumpBack(std::size_t target);
+        std::uint32_t constant(values::Value value);
+
+        void statement(frontend::AST::Stmt* stmt);
+        void block(const frontend::AST::List<frontend::AST::Stmt*>& body);
+        std::uint32_t function_body(frontend::AST::FunDeclare* declaration);
+    };
+}
@@ -1,52 +1,56 @@
 #include "environment.hpp"
+#include "heap.hpp"
 #include "../utils.hpp"
+#include <algorithm>
 #include <iostream>
 
 using namespace runtime;
+using frontend::Symbols;
 
 Environment* Environment::setupEnv() {
-    auto env = new Environment(nullptr);
-    env->declareVar("null", utils::MK_NULL(), true);
-    env->declareVar("true", utils::MK_BOOL(true), true);
-    env->declareVar("false", utils::MK_BOOL(false), true);
+    auto env = Heap::make<Environment>(nullptr);
+    Heap::addRoot(env);
+    env->declareVar(Symbols::intern("null"), utils::MK_NULL(), true);
+    env->declareVar(Symbols::intern("true"), utils::MK_BOOL(true), true);
+    env->declareVar(Symbols::intern("false"), utils::MK_BOOL(false), true);
 
-    env->declareVar("print", utils::MK_NATIVE_FN([](std::deque<std::shared_ptr<values::RuntimeVal>> args, Environment* scope) -> std::unique_ptr<values::RuntimeVal> {
+    env->declareVar(Symbols::intern("print"), utils::MK_NATIVE_FN([](std::span<const values::Value> args, Environment* scope) -> values::Value {
         for (auto& arg : args) {
-            if (arg->type == values::ValueType::Number) {
-                std::cout << dynamic_cast<values::NumVal*>(arg.get())->value;
-            } else if (arg->type == values::ValueType::Boolean) {
-                auto boolthing = dynamic_cast<values::BoolVal*>(arg.get())->value;
+            if (arg.isNumber()) {
+                std::cout << arg.asNumber();
+            } else if (arg.isBoolean()) {
+                auto boolthing = arg.asBoolean();
                 if (boolthing) {
                     std::cout << "true";
                 } else {
                     std::cout << "false";
                 }
-            } else if (arg->type == values::ValueType::String) {
-                std::cout << dynamic_cast<values::StringVal*>(arg.get())->value;
+            } else if (arg.type() == values::ValueType::String) {
+                std::cout << arg.as<values::StringVal>()->text();
             }
         }
 
-        return std::make_unique<values::RuntimeVal>();
+        return values::Value::null();
     }), true);
 
-    env->declareVar("throw", utils::MK_NATIVE_FN([](std::deque<std::shared_ptr<values::RuntimeVal>> args, Environment* scope) -> std::unique_ptr<values::RuntimeVal> {
-        throw std::invalid_argument(std::to_string(dynamic_cast<values::NumVal*>(args[0].get())->value));
+    env->declareVar(Symbols::intern("throw"), utils::MK_NATIVE_FN([](std::span<const values::Value> args, Environment* scope) -> values::Value {
+        throw std::invalid_argument(std::to_string(args[0].asNumber()));
     }), true);
 
-    env->declareVar("input", utils::MK_NATIVE_FN([](std::deque<std::shared_ptr<values::RuntimeVal>> args, Environment* scope) -> std::unique_ptr<values::RuntimeVal> {
+    env->declareVar(Symbols::intern("input"), utils::MK_NATIVE_FN([](std::span<const values::Value> args, Environment* scope) -> values::Value {
         std::string input;
         for (auto& arg : args) {
-            if (arg->type == values::ValueType::Number) {
-                std::cout << dynamic_cast<values::NumVal*>(arg.get())->value;
-            } else if (arg->type == values::ValueType::Boolean) {
-                auto boolthing = dynamic_cast<values::BoolVal*>(arg.get())->value;
+            if (arg.isNumber()) {
+                std::cout << arg.asNumber();
+            } else if (arg.isBoolean()) {
+                auto boolthing = arg.asBoolean();
                 if (boolthing) {
                     std::cout << "true";
                 } else {
                     std::cout << "false";
                 }
-            } else if (arg->type == values::ValueType::String) {
-                std::cout << dynamic_cast<values::StringVal*>(arg.get())->value;
+            } else if (arg.type() == values::ValueType::String) {
+                std::cout << arg.as<values::StringVal>()->text();
             }
         }
 
@@ -58,41 +62,61 @@ Environment* Environment::setupEnv() {
     return env;
 }
 
-std::unique_ptr<values::RuntimeVal> Environment::declareVar(const std::string& name, std::unique_ptr<values::RuntimeVal> value, bool constant) {
-    if (variables.find(name) != variables.end()) {
-        throw std::invalid_argument(fmt::format("Variable {} is already declared.", name));
+values::Value Environment::declareVar(frontend::SymbolId name, values::Value value, bool constant) {
+    for (auto existing : names) {
+        if (existing == name) {
+            throw std::invalid_argument(fmt::format("Variable {} is already declared.", Symbols::name(name)));
+        }
     }
 
-    variables.insert({name, std::move(value)});
+    ownedNames.assign(names.begin(), names.end());
+    ownedNames.push_back(name);
+    names = ownedNames;
+    resize(slotCount + 1);
+    return declareAt(slotCount - 1, value, constant);
+}
 
-    if (constant) {
-        constants.insert(name);
+void Environment::trace(Tracer& tracer) {
+    tracer.mark(parent);
+    for (std::uint32_t slot = 0; slot < slotCount; ++slot) {
+        if (declared.test(slot)) tracer.mark(slots[slot]);
     }
-    return value;
 }
 
-std::unique_ptr<values::RuntimeVal> Environment::assignVar(const std::string& name, std::unique_ptr<values::RuntimeVal> value) {
-    auto env = this->resolve(name);
-    if (env->constants.find(name) != env->constants.end()) {
-        throw std::runtime_error(fmt::format("Cannot reassign to {} as it is constant.", name));
+void Environment::resize(std::uint32_t count) {
+    declared.resize(count);
+    constants.resize(count);
+    if (count > INLINE_SLOTS) {
+        if (slots == inlineSlots) {
+            spilled.assign(inlineSlots, inlineSlots + slotCount);
+        }
+        spilled.resize(count);
+        slots = spilled.data();
     }
-    env->variables[name] = std::move(value);
-    return value;
+    slotCount = count;
 }
 
-std::unique_ptr<values::RuntimeVal> Environment::lookupVar(const std::string& name) {
-    auto env = this->resolve(name);
-    return std::move(env->variables[name]);
+std::string Environment::slotName(std::uint32_t slot) const {
+    return slot < names.size() ? Symbols::name(names[slot]) : fmt::format("<slot {}>", slot);
 }
 
-Environment* Environment::resolve(const std::string& name) {
-    if (variables.find(name) != variables.end()) {
-        return this;
-    }
+void Environment::undeclared(std::uint32_t slot) const {
+    throw std::invalid_argument(fmt::format("Cannot resolve {} as it doesn't exist.", slotName(slot)));
+}
 
-    if (parent == nullptr) {
-        throw std::invalid_argument(fmt::format("Cannot resolve {} as it doesn't exist.", name));
+void Environment::alreadyDeclared(std::uint32_t slot) const {
+    throw std::invalid_argument(fmt::format("Variable {} is already declared.", slotName(slot)));
+}
+
+void Environment::reassignedConstant(std::uint32_t slot) const {
+    throw std::runtime_error(fmt::format("Cannot reassign to {} as it is constant.", slotName(slot)));
+}
+
+void Environment::layout(std::span<const frontend::SymbolId> globals) {
+    if (globals.size() < slotCount || !std::equal(names.begin(), names.end(), globals.begin())) {
+        throw std::runtime_error("Environment: program was resolved against different builtins.");
     }
 
-    return parent->resolve(name);
-}
\ No newline at end of file
+    names = globals;
+    resize(static_cast<std::uint32_t>(globals.size()));
+}
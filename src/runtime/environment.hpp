@@ -1,26 +1,142 @@
 #pragma once
 #include "values.hpp"
+#include "heap_object.hpp"
 #include <unordered_map>
 #include <stdexcept>
-#include <set>
+#include <algorithm>
+#include <span>
+#include <string>
+#include <vector>
 #include <fmt/core.h>
 #include <deque>
 
 namespace runtime {
-    class Environment {
+    // one bit per slot. the first 64 are inline, which is every function scope in practice.
+    class SlotBits {
     private:
+        std::uint64_t small = 0;
+        std::vector<std::uint64_t> large; // bits 64 and up
+    public:
+        bool test(std::uint32_t index) const {
+            if (index < 64) return (small >> index) & 1;
+            index -= 64;
+            return (large[index / 64] >> (index % 64)) & 1;
+        }
+        void set(std::uint32_t index) {
+            if (index < 64) {
+                small |= std::uint64_t(1) << index;
+                return;
+            }
+            index -= 64;
+            large[index / 64] |= std::uint64_t(1) << (index % 64);
+        }
+        void resize(std::size_t count) {
+            if (count > 64) large.resize((count - 64 + 63) / 64);
+        }
+        void clear() {
+            small = 0;
+            std::fill(large.begin(), large.end(), 0);
+        }
+    };
+
+    // one scope's variables, stored by the slot the resolver gave them. slots exist from the start
+    // but only count as declared once their declaration runs, so reading a variable early or
+    // declaring one twice (a var inside a loop) is still an error at runtime.
+    //
+    // small scopes keep their slots inline, so a call's scope costs no allocation to set up or drop.
+    // the global scope and the scopes functions can capture are on the heap, the rest belong to the
+    // engine running the call, see HeapObject.
+    class Environment : public HeapObject {
+    private:
+        static constexpr std::uint32_t INLINE_SLOTS = 8;
+
         Environment* parent;
-        std::unordered_map<std::string, std::unique_ptr<values::RuntimeVal>> variables;
-        std::set<std::string> constants;
+        values::Value* slots = inlineSlots;
+        std::uint32_t slotCount = 0;
+        SlotBits declared;
+        SlotBits constants;
+        values::Value inlineSlots[INLINE_SLOTS];
+        std::vector<values::Value> spilled; // used instead once there's more than INLINE_SLOTS
+        // slot names, only read for error messages and can be left empty. points into the program,
+        // the global scope keeps its own copy while the builtins are being declared.
+        std::span<const frontend::SymbolId> names;
+        std::vector<frontend::SymbolId> ownedNames;
+
+        Environment* ancestor(std::uint32_t depth) {
+            auto env = this;
+            for (; depth > 0; --depth) {
+                env = env->parent;
+            }
+            return env;
+        }
+
+        void resize(std::uint32_t count);
+        std::string slotName(std::uint32_t slot) const;
+        // the errors are out of line so the fast paths above stay small enough to inline.
+        [[noreturn]] void undeclared(std::uint32_t slot) const;
+        [[noreturn]] void alreadyDeclared(std::uint32_t slot) const;
+        [[noreturn]] void reassignedConstant(std::uint32_t slot) const;
     public:
-        Environment(Environment* parent) : parent(parent) {
-            bool global = this->parent ? true : false;
+        Environment(Environment* parent) : parent(parent) {}
+        Environment(Environment* parent, std::span<const frontend::SymbolId> locals) {
+            reset(parent, locals);
+        }
+        // slots points into the object itself.
+        Environment(const Environment&) = delete;
+        Environment& operator=(const Environment&) = delete;
+
+        // the parent and every declared slot, slots that aren't declared yet can hold anything.
+        void trace(Tracer& tracer) override;
+
+        // turns this into a fresh scope, so the vm can keep reusing the same few for its calls.
+        void reset(Environment* parent, std::span<const frontend::SymbolId> locals) {
+            this->parent = parent;
+            names = locals;
+            declared.clear();
+            constants.clear();
+            slots = inlineSlots;
+            slotCount = 0;
+            auto count = static_cast<std::uint32_t>(locals.size());
+            if (count <= INLINE_SLOTS) {
+                slotCount = count;
+            } else {
+                resize(count);
+            }
+        }
+
+        // adds a new slot at the end, only used for the builtins before a program is laid out.
+        values::Value declareVar(frontend::SymbolId name, values::Value value, bool constant);
+        values::Value declareAt(std::uint32_t slot, values::Value value, bool constant) {
+            if (declared.test(slot)) alreadyDeclared(slot);
+            values::barrier(value);
+            slots[slot] = value;
+            declared.set(slot);
+            if (constant) constants.set(slot);
+            return value;
+        }
+
+        values::Value lookupAt(std::uint32_t depth, std::uint32_t slot) {
+            auto env = ancestor(depth);
+            if (!env->declared.test(slot)) env->undeclared(slot);
+            return env->slots[slot];
+        }
+        values::Value assignAt(std::uint32_t depth, std::uint32_t slot, values::Value value) {
+            auto env = ancestor(depth);
+            if (!env->declared.test(slot)) env->undeclared(slot);
+            if (env->constants.test(slot)) env->reassignedConstant(slot);
+            values::barrier(value);
+            env->slots[slot] = value;
+            return value;
+        }
+
+        // grows the global scope to fit a resolved program's globals. they have to start with the
+        // builtins this scope already has, in the same order.
+        void layout(std::span<const frontend::SymbolId> globals);
+        // what the resolver should take as already declared, slot by slot.
+        std::span<const frontend::SymbolId> slotNames() const {
+            return names;
         }
-        std::unique_ptr<values::RuntimeVal> declareVar(const std::string& name, std::unique_ptr<values::RuntimeVal> value, bool constant);
-        std::unique_ptr<values::RuntimeVal> assignVar(const std::string& name, std::unique_ptr<values::RuntimeVal> value);
-        std::unique_ptr<values::RuntimeVal> lookupVar(const std::string& name);
-        Environment* resolve(const std::string& name);
 
         static Environment* setupEnv();
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,176 @@
+#include "interpreter.hpp"
+#include <iostream>
+#include "../utils.hpp"
+#include "heap.hpp"
+
+using namespace runtime;
+using namespace frontend;
+
+// same semantics as the pointer walker in interpreter.cpp, only reading FlatAST records instead of Stmt nodes.
+
+values::Value interpreter::evaluate_flat_block(const FlatAST& ast, std::uint32_t list, Environment* env) {
+    return evaluate_flat_block(ast, ast.list(list), env);
+}
+
+values::Value interpreter::evaluate_flat_block(const FlatAST& ast, AST::List<std::uint32_t> body, Environment* env) {
+    auto lastEvaluated = values::Value::null();
+    for (auto index : body) {
+        lastEvaluated = evaluate(ast, index, env);
+        if (completion != Completion::Normal) break;
+    }
+    return lastEvaluated;
+}
+
+values::Value interpreter::evaluate_pinned(values::Value keep, const FlatAST& ast, FlatAST::Index index, Environment* env) {
+    ArgumentStack::Frame pin(pinned);
+    pin.push(keep);
+    return evaluate(ast, index, env);
+}
+
+values::Value interpreter::evaluate(const FlatAST& ast, FlatAST::Index index, Environment* env) {
+    stack.check();
+    const FlatAST::Node& node = ast.nodes[index];
+
+    switch (node.kind) {
+        case AST::NodeType::NumericLiteral: {
+            return values::Value::number(static_cast<int>(node.a));
+        }
+        case AST::NodeType::Identifier: {
+            return env->lookupAt(node.b, node.c);
+        }
+        case AST::NodeType::BinaryExpr: {
+            auto lhs = evaluate(ast, node.a, env);
+            auto rhs = lhs.isObject() ? evaluate_pinned(lhs, ast, node.b, env) : evaluate(ast, node.b, env);
+            return apply_binary(lhs, rhs, static_cast<AST::BinaryOp>(node.op));
+        }
+        case AST::NodeType::CompExpr: {
+            auto lhs = evaluate(ast, node.a, env);
+            auto rhs = lhs.isObject() ? evaluate_pinned(lhs, ast, node.b, env) : evaluate(ast, node.b, env);
+            return apply_comparison(lhs, rhs, static_cast<AST::CompareOp>(node.op));
+        }
+        case AST::NodeType::Program: {
+            stack.enter();
+            env->layout(ast.list(node.b));
+            flatCaches.assign(node.c, PropertyCache());
+            return evaluate_flat_block(ast, node.a, env);
+        }
+        case AST::NodeType::VarDeclare: {
+            auto value = node.b != FlatAST::NONE ? evaluate(ast, node.b, env) : utils::MK_NULL();
+            return env->declareAt(node.c, value, node.op != 0);
+        }
+        case AST::NodeType::AssignmentExpr: {
+            auto& assignee = ast.nodes[node.a];
+            if (assignee.kind != AST::NodeType::Identifier) {
+                throw std::runtime_error(fmt::format("Invalid LHS in assignment expression."));
+            }
+            return env->assignAt(assignee.b, assignee.c, evaluate(ast, node.b, env));
+        }
+        case AST::NodeType::ObjectLiteral: {
+            auto object = Heap::make<values::ObjectVal>();
+            auto properties = ast.list(node.a);
+            object->reserve(properties.count);
+            ArgumentStack::Frame pin(pinned);
+            pin.push(values::Value::object(object));
+
+            for (auto propIndex : properties) {
+                auto& prop = ast.nodes[propIndex];
+                object->define(prop.a, evaluate(ast, prop.b, env));
+            }
+
+            return values::Value::object(object);
+        }
+        case AST::NodeType::CallExpr: {
+            if (node.op != 0) {
+                tailFrame->clear();
+                for (auto arg : ast.list(node.b)) {
+                    tailFrame->push(evaluate(ast, arg, env));
+                }
+                return evaluate_tail_call(evaluate(ast, node.a, env), env);
+            }
+
+            ArgumentStack::Frame frame(arguments);
+            for (auto arg : ast.list(node.b)) {
+                frame.push(evaluate(ast, arg, env));
+            }
+            auto callee = evaluate(ast, node.a, env);
+            return call_function(callee, frame.args(), env);
+        }
+        case AST::NodeType::FunctionDeclaration: {
+            auto scope = ast.scope(index);
+            auto fn = Heap::make<values::FunValue>();
+            fn->name = node.a;
+            fn->params = scope.params;
+            fn->locals = scope.locals;
+            fn->decEnv = env;
+            fn->flat = &ast;
+            fn->flatBody = ast.list(node.c);
+            fn->captured = node.op != 0;
+
+            return env->declareAt(scope.nameSlot, values::Value::object(fn), true);
+        }
+        case AST::NodeType::If: {
+            if (is_true(evaluate(ast, node.a, env))) {
+                return evaluate_flat_block(ast, node.b, env);
+            }
+            if (node.c != FlatAST::NONE) {
+                return evaluate_flat_block(ast, node.c, env);
+            }
+            return values::Value::null();
+        }
+        case AST::NodeType::MemberExpr: {
+            auto& property = ast.nodes[node.b];
+            if (property.kind != AST::NodeType::Identifier) {
+                throw std::runtime_error("Interpreter: Property in member expression is not an identifier.");
+            }
+            return access_member(evaluate(ast, node.a, env), property.a, flatCaches[node.c]);
+        }
+        case AST::NodeType::StringLiteral: {
+            return utils::MK_STRING_LITERAL(ast.string(node.a));
+        }
+        case AST::NodeType::While: {
+            values::Value lastEvaluated;
+            ArgumentStack::Frame pin(pinned);
+            pin.push(lastEvaluated);
+
+            while (is_true(evaluate(ast, node.a, env))) {
+                for (auto stmt : ast.list(node.b)) {
+                    auto value = evaluate(ast, stmt, env);
+                    if (completion != Completion::Normal) {
+                        if (completion == Completion::Return || completion == Completion::TailCall) {
+                            return value;
+                        }
+                        break;
+                    }
+                    lastEvaluated = value;
+                    pin.set(0, value);
+                }
+
+                if (completion == Completion::Break) {
+                    completion = Completion::Normal;
+                    break;
+                }
+                completion = Completion::Normal;
+            }
+            return lastEvaluated;
+        }
+        case AST::NodeType::BreakStmt: {
+            completion = Completion::Break;
+            return values::Value::null();
+        }
+        case AST::NodeType::ContinueStmt: {
+            completion = Completion::Continue;
+            return values::Value::null();
+        }
+        case AST::NodeType::ReturnStmt: {
+            auto value = node.a != FlatAST::NONE ? evaluate(ast, node.a, env) : values::Value::null();
+            if (completion == Completion::Normal) {
+                completion = Completion::Return;
+            }
+            return value;
+        }
+        default: {
+            std::cout << "Interpreter: This AST has not been yet setup for interpretation." << std::endl;
+            exit(1);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "heap.hpp"
+#include <algorithm>
+#include <chrono>
+#include "environment.hpp"
+
+using namespace runtime;
+
+Heap::State& Heap::heap() {
+    static State state;
+    return state;
+}
+
+Heap::State::~State() {
+    HeapObject::barrierActive = false;
+    // in the middle of a sweep, the objects between sweepOut and sweepIndex were moved or freed already.
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+        if (phase == Phase::Sweeping && i >= sweepOut && i < sweepIndex) continue;
+        delete objects[i].object;
+    }
+}
+
+const char* Heap::kindName(std::size_t kind) {
+    static constexpr const char* names[KIND_COUNT] = {"null", "number", "boolean", "object", "native function", "function", "string", "scope"};
+    return names[kind];
+}
+
+void Heap::addRoot(HeapObject* object) {
+    heap().roots.push_back(object);
+}
+
+void HeapObject::shade(HeapObject* object) {
+    Heap::heap().tracer.mark(object);
+}
+
+RootSource::RootSource() {
+    Heap::heap().sources.push_back(this);
+}
+
+RootSource::~RootSource() {
+    auto& sources = Heap::heap().sources;
+    sources.erase(std::find(sources.begin(), sources.end(), this));
+}
+
+void CallStack::trace(Tracer& tracer) const {
+    for (auto& call : calls) {
+        tracer.mark(call.callee);
+        tracer.mark(call.scope);
+    }
+}
+
+void Heap::State::traceRoots() {
+    for (auto root : roots) {
+        tracer.mark(root);
+    }
+    for (auto source : sources) {
+        source->traceRoots(tracer);
+    }
+}
+
+void Heap::State::startMarking() {
+    phase = Phase::Marking;
+    HeapObject::barrierActive = true;
+    stepLimit = nextCollection * GROWTH_FACTOR;
+    traceRoots();
+}
+
+void Heap::State::mark(std::size_t work, std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        if (tracer.drain(std::min(work, STEP_CHUNK))) {
+            finishMarking();
+            return;
+        }
+        work -= std::min(work, STEP_CHUNK);
+        if (work == 0 || std::chrono::steady_clock::now() >= deadline) return;
+    }
+}
+
+// the roots aren't behind the barrier, so they're traced again. whatever they reach that isn't
+// marked yet is all that's left, this is the one pause marking can't split.
+void Heap::State::finishMarking() {
+    traceRoots();
+    tracer.drain();
+    HeapObject::barrierActive = false;
+    phase = Phase::Sweeping;
+    sweepIndex = 0;
+    sweepOut = 0;
+    sweepEnd = objects.size();
+}
+
+void Heap::State::sweep(std::size_t work, std::chrono::steady_clock::time_point deadline) {
+    while (work > 0 && sweepIndex < sweepEnd) {
+        auto chunkEnd = std::min(sweepEnd, sweepIndex + std::min(work, STEP_CHUNK));
+        work -= chunkEnd - sweepIndex;
+        for (; sweepIndex < chunkEnd; ++sweepIndex) {
+            auto allocation = objects[sweepIndex];
+            if (allocation.object->marked) {
+                allocation.object->marked = false;
+                objects[sweepOut++] = allocation;
+                continue;
+            }
+            stats.objects--;
+            stats.live[allocation.kind]--;
+            stats.bytes -= allocation.size;
+            stats.freedObjects++;
+            delete allocation.object;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) break;
+    }
+    if (sweepIndex == sweepEnd) {
+        finishSweeping();
+    }
+}
+
+void Heap::State::finishSweeping() {
+    // what was made since marking ended moves down behind the survivors.
+    auto made = objects.begin() + sweepEnd;
+    std::move(made, objects.end(), objects.begin() + sweepOut);
+    objects.resize(sweepOut + (objects.size() - sweepEnd));
+    phase = Phase::Idle;
+    stats.collections++;
+    nextCollection = std::max(MIN_COLLECTION_BYTES, stats.bytes * GROWTH_FACTOR);
+}
+
+void Heap::State::recordPause(double ms) {
+    stats.steps++;
+    stats.totalPauseMs += ms;
+    stats.maxPauseMs = std::max(stats.maxPauseMs, ms);
+    auto bucket = std::lower_bound(PAUSE_BUCKETS.begin(), PAUSE_BUCKETS.end(), ms) - PAUSE_BUCKETS.begin();
+    stats.pauses[bucket]++;
+}
+
+void Heap::step() {
+    auto& state = heap();
+    if (state.pauseTargetMs <= 0) {
+        collect();
+        state.nextStep = state.nextCollection;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(state.pauseTargetMs));
+    auto work = STEP_WORK;
+    if (state.phase != Phase::Idle && state.stats.bytes >= state.stepLimit) {
+        // the mutator is outgrowing this collection, it gets finished right here.
+        work = SIZE_MAX;
+        deadline = std::chrono::steady_clock::time_point::max();
+    }
+
+    if (state.phase == Phase::Idle) {
+        state.startMarking();
+    }
+    if (state.phase == Phase::Marking) {
+        state.mark(work, deadline);
+    }
+    // marking can end early, the rest of the step goes to sweeping.
+    if (state.phase == Phase::Sweeping && std::chrono::steady_clock::now() < deadline) {
+        state.sweep(work, deadline);
+    }
+
+    state.recordPause(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    state.nextStep = state.phase == Phase::Idle ? state.nextCollection : state.stats.bytes + STEP_BYTES;
+}
+
+void Heap::collect() {
+    auto start = std::chrono::steady_clock::now();
+    auto& state = heap();
+    auto forever = std::chrono::steady_clock::time_point::max();
+
+    // a collection in progress is finished first, its marks are still good.
+    if (state.phase == Phase::Marking) {
+        state.finishMarking();
+    }
+    if (state.phase == Phase::Sweeping) {
+        state.sweep(SIZE_MAX, forever);
+    }
+    state.startMarking();
+    state.finishMarking();
+    state.sweep(SIZE_MAX, forever);
+
+    state.recordPause(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+// what each kind of heap value points to.
+
+void values::ObjectVal::trace(Tracer& tracer) {
+    for (std::uint32_t i = 0; i < shape->size(); ++i) {
+        tracer.mark(slot(i));
+    }
+}
+
+void values::StringVal::trace(Tracer& tracer) {
+    tracer.mark(left);
+    tracer.mark(right);
+}
+
+void values::FunValue::trace(Tracer& tracer) {
+    tracer.mark(decEnv);
+}
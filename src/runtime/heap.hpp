@@ -0,0 +1,255 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "heap_object.hpp"
+#include "values.hpp"
+
+namespace runtime {
+    class Environment;
+
+    // the mark phase. marking an object queues it (it's gray), drain() then traces the queue until it's
+    // empty, so long chains of objects don't recurse. the heap keeps one across the steps of a
+    // collection.
+    class Tracer {
+    public:
+        void mark(HeapObject* object) {
+            if (!object || object->marked) return;
+            // unmanaged objects can't be freed, they're only traced, and never reached from the heap.
+            if (object->managed) object->marked = true;
+            gray.push_back(object);
+        }
+        void mark(values::Value value) {
+            if (value.isObject()) mark(value.asObject());
+        }
+        void drain() {
+            while (!gray.empty()) {
+                auto object = gray.back();
+                gray.pop_back();
+                object->trace(*this);
+            }
+        }
+        // traces at most limit objects, true once nothing is gray anymore.
+        bool drain(std::size_t limit) {
+            for (; limit > 0 && !gray.empty(); --limit) {
+                auto object = gray.back();
+                gray.pop_back();
+                object->trace(*this);
+            }
+            return gray.empty();
+        }
+    private:
+        std::vector<HeapObject*> gray;
+    };
+
+    // something that holds values the heap can't see on its own: an engine's value stack, the scopes of
+    // the calls it has in progress, its compiled constants. registers itself for as long as it lives.
+    class RootSource {
+    public:
+        RootSource();
+        virtual ~RootSource();
+        RootSource(const RootSource&) = delete;
+        RootSource& operator=(const RootSource&) = delete;
+
+        virtual void traceRoots(Tracer& tracer) = 0;
+    };
+
+    // keeps a few values alive for as long as it's in scope, for C++ code that holds them across an
+    // allocation. registers like any RootSource, so it's for the odd spot and not for hot paths.
+    template <std::size_t N>
+    class LocalRoots : public RootSource {
+    public:
+        template <typename... Values>
+        explicit LocalRoots(Values... values) : held{values...} {}
+
+        void traceRoots(Tracer& tracer) override {
+            for (auto value : held) {
+                tracer.mark(value);
+            }
+        }
+    private:
+        std::array<values::Value, N> held;
+    };
+
+    // the script calls an engine has in progress, innermost last: the function and the scope it runs
+    // in. the tree walkers keep both in C++ locals, so this is how the collector finds them.
+    class CallStack {
+    public:
+        class Entry {
+        public:
+            Entry(CallStack& stack, values::Value callee, Environment* scope) : stack(stack) {
+                stack.calls.push_back({callee, scope});
+            }
+            ~Entry() {
+                stack.calls.pop_back();
+            }
+            Entry(const Entry&) = delete;
+            Entry& operator=(const Entry&) = delete;
+
+            // a tail call swaps in the call it makes.
+            void set(values::Value callee, Environment* scope) {
+                stack.calls.back() = {callee, scope};
+            }
+        private:
+            CallStack& stack;
+        };
+
+        void trace(Tracer& tracer) const;
+    private:
+        struct Call {
+            values::Value callee;
+            Environment* scope;
+        };
+        std::vector<Call> calls;
+    };
+
+    // owns every heap value (strings, objects, functions) and every scope a function can keep. a Value
+    // only borrows the pointer, so copying one around is just copying 8 bytes.
+    //
+    // precise mark-sweep: once enough has been allocated since the last collection, the next make()
+    // starts marking everything reachable from the roots (the global scope and every RootSource) and
+    // the rest gets freed. only make() collects, so values an engine holds in C++ locals are safe until
+    // it allocates.
+    //
+    // collections are incremental. every STEP_BYTES allocated, make() does one step of marking or
+    // sweeping and stops once it has taken the pause target. while marking, the write barrier shades
+    // whatever gets stored (see values::barrier) and new objects are born marked, then marking ends
+    // with one short pause that traces the roots again. sweeping is lazy, objects made after marking
+    // ended aren't looked at until the next collection. a pause target of 0 collects in one go.
+    class Heap {
+    public:
+        Heap() = delete;
+
+        // upper bounds of the pause histogram's buckets in ms, the last bucket takes anything longer.
+        static constexpr std::array<double, 8> PAUSE_BUCKETS = {0.05, 0.1, 0.25, 0.5, 1, 2, 5, 10};
+        // what the per kind counters are indexed by: a ValueType, or SCOPE_KIND for scopes.
+        static constexpr std::size_t SCOPE_KIND = static_cast<std::size_t>(values::ValueType::String) + 1;
+        static constexpr std::size_t KIND_COUNT = SCOPE_KIND + 1;
+        static const char* kindName(std::size_t kind);
+
+        struct Stats {
+            std::size_t collections = 0; // finished ones
+            std::size_t steps = 0;
+            double totalPauseMs = 0;
+            double maxPauseMs = 0;
+            std::array<std::size_t, PAUSE_BUCKETS.size() + 1> pauses{}; // steps by how long they took
+            std::size_t objects = 0; // live right now
+            std::size_t bytes = 0; // sizeof of every live object, not counting what they point to
+            std::size_t peakBytes = 0;
+            std::size_t freedObjects = 0;
+            std::array<std::size_t, KIND_COUNT> made{};
+            std::array<std::size_t, KIND_COUNT> live{};
+        };
+
+        template <typename T, typename... Args>
+        static T* make(Args&&... args) {
+            auto& state = heap();
+            if (state.stats.bytes >= state.nextStep) {
+                step();
+            }
+            auto object = new T(std::forward<Args>(args)...);
+            object->managed = true;
+            if (state.phase == Phase::Marking) {
+                // it's traced once its fields are set, they don't all go through the barrier.
+                state.tracer.mark(object);
+            }
+            auto kind = kindOf(object);
+            state.objects.push_back({object, static_cast<std::uint32_t>(sizeof(T)), kind});
+            state.stats.made[kind]++;
+            state.stats.live[kind]++;
+            state.stats.objects++;
+            state.stats.bytes += sizeof(T);
+            if (state.stats.bytes > state.stats.peakBytes) state.stats.peakBytes = state.stats.bytes;
+            return object;
+        }
+
+        // finishes the collection in progress, if any, then does a whole one.
+        static void collect();
+        // kept alive for good, the global scope.
+        static void addRoot(HeapObject* object);
+
+        // how long one step may take in ms, 0 makes every collection a single stop-the-world pause.
+        static void setPauseTarget(double ms) {
+            heap().pauseTargetMs = ms;
+        }
+
+        static const Stats& stats() {
+            return heap().stats;
+        }
+        static std::size_t objectCount() {
+            return heap().stats.objects;
+        }
+    private:
+        friend class RootSource;
+        friend class HeapObject;
+
+        // the heap is allowed to grow to this much over what survived the last collection.
+        static constexpr std::size_t GROWTH_FACTOR = 2;
+        static constexpr std::size_t MIN_COLLECTION_BYTES = 2 * 1024 * 1024;
+        // a step runs every STEP_BYTES allocated and does at most STEP_WORK objects of marking or
+        // sweeping, several times what was made since the last one, so collections keep ahead.
+        static constexpr std::size_t STEP_BYTES = 64 * 1024;
+        static constexpr std::size_t STEP_WORK = 8192;
+        // how often a step looks at the clock, in objects.
+        static constexpr std::size_t STEP_CHUNK = 256;
+        static constexpr double DEFAULT_PAUSE_TARGET_MS = 1;
+
+        enum class Phase {
+            Idle,
+            Marking,
+            Sweeping
+        };
+
+        struct Allocation {
+            HeapObject* object;
+            std::uint32_t size;
+            std::uint8_t kind;
+        };
+
+        template <typename T>
+        static std::uint8_t kindOf(T* object) {
+            if constexpr (std::is_base_of_v<values::RuntimeVal, T>) {
+                return static_cast<std::uint8_t>(object->type);
+            } else {
+                return static_cast<std::uint8_t>(SCOPE_KIND);
+            }
+        }
+
+        struct State {
+            std::vector<Allocation> objects;
+            std::vector<HeapObject*> roots;
+            std::vector<RootSource*> sources;
+            Phase phase = Phase::Idle;
+            Tracer tracer;
+            // the lazy sweep compacts objects in place: [0, sweepOut) survived, [sweepIndex, sweepEnd)
+            // is still to be looked at, and everything from sweepEnd on was made after marking.
+            std::size_t sweepIndex = 0;
+            std::size_t sweepOut = 0;
+            std::size_t sweepEnd = 0;
+            std::size_t nextCollection = MIN_COLLECTION_BYTES;
+            std::size_t nextStep = MIN_COLLECTION_BYTES;
+            // a collection the mutator outgrows this far is finished in one go instead.
+            std::size_t stepLimit = 0;
+            double pauseTargetMs = DEFAULT_PAUSE_TARGET_MS;
+            Stats stats;
+
+            void startMarking();
+            void traceRoots();
+            // both do at most work objects and stop at the deadline, and move on to the next phase when
+            // they're done.
+            void mark(std::size_t work, std::chrono::steady_clock::time_point deadline);
+            void finishMarking();
+            void sweep(std::size_t work, std::chrono::steady_clock::time_point deadline);
+            void finishSweeping();
+            void recordPause(double ms);
+
+            ~State();
+        };
+        static State& heap();
+        static void step();
+    };
+}
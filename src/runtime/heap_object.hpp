@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include "slab.hpp"
+
+namespace runtime {
+    class Tracer;
+
+    // anything the collector can see: heap values and scopes. objects made by Heap::make are managed,
+    // the heap frees them once nothing reaches them. unmanaged ones (call scopes an engine keeps on
+    // the C++ stack or in a pool) belong to whoever made them and only get traced as roots.
+    class HeapObject {
+    public:
+        HeapObject() {}
+        virtual ~HeapObject() = default;
+
+        // out of the size-class pools. the destructor is virtual, so delete passes the size of the
+        // object's actual type.
+        static void* operator new(std::size_t size) {
+            return SlabAllocator::allocate(size);
+        }
+        static void operator delete(void* pointer, std::size_t size) {
+            SlabAllocator::deallocate(pointer, size);
+        }
+
+        // marks everything this object points to.
+        virtual void trace(Tracer&) {}
+
+        bool marked = false;
+        bool managed = false;
+
+        // set while an incremental collection is marking. anything stored into a heap value or a
+        // scope then has to be shaded, the collector may have traced the place it's stored already.
+        // see values::barrier.
+        static inline bool barrierActive = false;
+        static void shade(HeapObject* object);
+    };
+}
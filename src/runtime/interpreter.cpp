@@ -1,221 +1,360 @@
 #include "interpreter.hpp"
 #include <iostream>
 #include "../utils.hpp"
+#include "heap.hpp"
+#include "numbers.hpp"
 
 using namespace runtime;
 using namespace frontend;
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_program(AST::Program* program, Environment* env) {
-    auto lastEvaluated = std::make_unique<values::RuntimeVal>();
+values::Value interpreter::evaluate_program(AST::Program* program, Environment* env) {
+    stack.enter();
+    env->layout(program->globals);
 
-    for (auto& statement : program->body) {
-        lastEvaluated = evaluate(statement, env);
-    }
+    return evaluate_block(program->body, env);
+}
 
+// stops early when a statement doesn't complete normally, its value is then the block's.
+values::Value interpreter::evaluate_block(const AST::List<AST::Stmt*>& body, Environment* env) {
+    auto lastEvaluated = values::Value::null();
+    for (auto stmt : body) {
+        lastEvaluated = evaluate(stmt, env);
+        if (completion != Completion::Normal) break;
+    }
     return lastEvaluated;
 }
 
-std::unique_ptr<values::NumVal> interpreter::evaluate_numeric_binary_expr(std::unique_ptr<values::NumVal> lhs, std::unique_ptr<values::NumVal> rhs, const std::string& op) {
-    int result = 0;
-
-    if (op == "+") result = lhs->value + rhs->value; else
-    if (op == "-") result = lhs->value - rhs->value; else
-    if (op == "*") result = lhs->value * rhs->value; else
-    if (op == "/") result = lhs->value / rhs->value; else
-    result = lhs->value % rhs->value;
+values::Value interpreter::evaluate_numeric_binary_expr(int lhs, int rhs, AST::BinaryOp op) {
+    return values::Value::number(numbers::arithmetic(op, lhs, rhs));
+}
 
+values::Value interpreter::apply_binary(values::Value lhs, values::Value rhs, AST::BinaryOp op) {
+    if (lhs.isNumber() && rhs.isNumber()) {
+        return evaluate_numeric_binary_expr(lhs.asNumber(), rhs.asNumber(), op);
+    }
+    if (op == AST::BinaryOp::Add && lhs.type() == values::ValueType::String && rhs.type() == values::ValueType::String) {
+        return values::StringVal::concat(lhs, rhs);
+    }
 
-    auto returnvalue = std::make_unique<values::NumVal>();
-    returnvalue->value = result;
-    return returnvalue;
+    return values::Value::null();
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_binary_expr(AST::BinEx* binop, Environment* env) {
+values::Value interpreter::evaluate_binary_expr(AST::BinEx* binop, Environment* env) {
+    // a string on the left has to stay alive while the right is evaluated.
     auto lhs = evaluate(binop->left, env);
-    auto rhs = evaluate(binop->right, env);
+    auto rhs = lhs.isObject() ? evaluate_pinned(lhs, binop->right, env) : evaluate(binop->right, env);
+    if (lhs.isNumber() && rhs.isNumber() && !binop->generic) {
+        binop->kind = AST::NodeType::IntBinaryExpr;
+    }
+    return apply_binary(lhs, rhs, binop->op);
+}
+
+values::Value interpreter::evaluate_int_binary_expr(AST::BinEx* binop, Environment* env) {
+    auto lhs = evaluate_operand(binop->left, env);
+    auto rhs = lhs.isObject() ? evaluate_pinned(lhs, binop->right, env) : evaluate_operand(binop->right, env);
+    if (lhs.isNumber() && rhs.isNumber()) [[likely]] {
+        return evaluate_numeric_binary_expr(lhs.asNumber(), rhs.asNumber(), binop->op);
+    }
+    binop->kind = AST::NodeType::BinaryExpr;
+    binop->generic = true;
+    return apply_binary(lhs, rhs, binop->op);
+}
 
-    if (lhs->type == values::ValueType::Number && rhs->type == values::ValueType::Number) {
-        return evaluate_numeric_binary_expr(std::make_unique<values::NumVal>(*static_cast<values::NumVal*>(lhs.get())), std::make_unique<values::NumVal>(*static_cast<values::NumVal*>(rhs.get())), binop->op);
+inline values::Value interpreter::evaluate_operand(AST::Expr* expr, Environment* env) {
+    switch (expr->kind) {
+        case AST::NodeType::NumericLiteral: {
+            return values::Value::number(static_cast<AST::NumericLiteral*>(expr)->value);
+        }
+        case AST::NodeType::Identifier: {
+            auto ident = static_cast<AST::Identifier*>(expr);
+            return env->lookupAt(ident->depth, ident->slot);
+        }
+        default: {
+            return evaluate(expr, env);
+        }
     }
+}
+
+values::Value interpreter::evaluate_identifier(AST::Identifier* ident, Environment* env) {
+    return env->lookupAt(ident->depth, ident->slot);
+}
 
-    return std::make_unique<values::RuntimeVal>();
+void interpreter::traceRoots(Tracer& tracer) {
+    arguments.trace(tracer);
+    pinned.trace(tracer);
+    calls.trace(tracer);
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_identifier(AST::Identifier* ident, Environment* env) {
-    return env->lookupVar(ident->symbol);
+values::Value interpreter::evaluate_pinned(values::Value keep, AST::Expr* expr, Environment* env) {
+    ArgumentStack::Frame pin(pinned);
+    pin.push(keep);
+    return evaluate(expr, env);
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_object_expr(AST::ObjectLiteral* obj, Environment* env) {
-    auto object = std::make_unique<values::ObjectVal>();
+values::Value interpreter::evaluate_object_expr(AST::ObjectLiteral* obj, Environment* env) {
+    auto object = Heap::make<values::ObjectVal>();
+    object->reserve(obj->properties.count);
+    ArgumentStack::Frame pin(pinned); // the values can allocate
+    pin.push(values::Value::object(object));
 
     for (auto& prop : obj->properties) {
-        auto runtimeVal = (prop->value.value() == nullptr) ? env->lookupVar(prop->key) : evaluate(static_cast<AST::Stmt*>(prop->value.value()), env);
+        // the parser turns {a} into {a: a}, so there's always a value.
+        auto runtimeVal = evaluate(static_cast<AST::Stmt*>(prop->value.value()), env);
 
-        object->properties.emplace(prop->key, std::move(runtimeVal));
+        object->define(prop->key, runtimeVal);
     }
 
-    return object;
+    return values::Value::object(object);
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_call_expr(AST::CallExpr* expr, Environment* env) {
-    std::deque<std::shared_ptr<values::RuntimeVal>> args;
+values::Value interpreter::evaluate_call_expr(AST::CallExpr* expr, Environment* env) {
+    if (expr->tail) {
+        // the current arguments are already in their slots, so the tail frame can take the new ones.
+        tailFrame->clear();
+        for (auto& arg : expr->args) {
+            tailFrame->push(evaluate(arg, env));
+        }
+        return evaluate_tail_call(evaluate(expr->caller, env), env);
+    }
+
+    ArgumentStack::Frame frame(arguments);
     for (auto& arg : expr->args) {
-        args.push_back(evaluate(arg, env));
+        frame.push(evaluate(arg, env));
+    }
+    auto callee = evaluate(expr->caller, env);
+    return call_function(callee, frame.args(), env);
+}
+
+values::Value interpreter::evaluate_tail_call(values::Value callee, Environment* env) {
+    if (callee.type() == values::ValueType::Function) {
+        completion = Completion::TailCall;
+        return callee;
     }
-    auto fn = evaluate(expr->caller, env);
+    return call_function(callee, tailFrame->args(), env);
+}
 
-    if (fn->type == values::ValueType::NativeFn) {
-        auto result = static_cast<values::NativeFnValue*>(fn.get())->call(args, env);
-        return result;
+values::Value interpreter::call_function(values::Value fn, std::span<const values::Value> args, Environment* env) {
+    if (fn.type() == values::ValueType::NativeFn) {
+        return fn.as<values::NativeFnValue>()->call(args, env);
+    }
+    if (fn.type() != values::ValueType::Function) {
+        throw std::runtime_error("Interpreter: Cannot call value that is not a function.");
     }
 
-    if (fn->type == values::ValueType::Function) {
-        
-        auto func = static_cast<values::FunValue*>(fn.get());
-        auto scope = std::unique_ptr<Environment>(func->decEnv);
+    CallDepth depth(callDepth, stack);
+    ArgumentStack::Frame tail(arguments);
+    auto outerTail = tailFrame;
+    tailFrame = &tail;
+    Environment stackScope(nullptr);
+    CallStack::Entry call(calls, fn, &stackScope);
+    while (true) {
+        // every call gets a fresh scope under the one the function was declared in, the params take
+        // the first slots. missing arguments are null, extra ones are dropped. a tail call resets the
+        // same scope for the next function instead of nesting another call.
+        //
+        // that scope lives here unless the function declares functions that can keep it, captured
+        // ones get theirs from the heap (and never make tail calls).
+        auto func = fn.as<values::FunValue>();
+        Environment* scope = &stackScope;
+        call.set(fn, scope);
+        if (func->captured) {
+            scope = Heap::make<Environment>(func->decEnv, func->locals);
+            call.set(fn, scope);
+        } else {
+            stackScope.reset(func->decEnv, func->locals);
+        }
 
-        for (int i = 0; i < func->params.size(); ++i) {
-            auto name = func->params[i];
-            scope->declareVar(name, std::unique_ptr<values::RuntimeVal>(args[i].get()), false);
+        for (std::uint32_t i = 0; i < func->params.size(); ++i) {
+            scope->declareAt(i, i < args.size() ? args[i] : values::Value::null(), false);
         }
 
-        auto result = std::unique_ptr<values::RuntimeVal>();
-        for (auto& stmt : func->body) {
-            result = evaluate(stmt, scope.get());
+        auto result = func->flat ? evaluate_flat_block(*func->flat, func->flatBody, scope) : evaluate_block(func->body, scope);
+        if (completion == Completion::TailCall) {
+            completion = Completion::Normal;
+            fn = result;
+            args = tail.args();
+            continue;
         }
 
+        completion = Completion::Normal; // a return, or nothing
+        tailFrame = outerTail;
         return result;
     }
-
-    throw std::runtime_error("Interpreter: Cannot call value that is not a function.");
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_var_declaration(AST::VarDeclare* declaration, Environment* env) {
+values::Value interpreter::evaluate_var_declaration(AST::VarDeclare* declaration, Environment* env) {
     auto value = declaration->value ? evaluate(declaration->value.value(), env) : utils::MK_NULL();
-    return env->declareVar(declaration->identifier, std::move(value), declaration->constant);
+    return env->declareAt(declaration->slot, value, declaration->constant);
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_assignment(AST::AssignExpr* node, Environment* env) {
+values::Value interpreter::evaluate_assignment(AST::AssignExpr* node, Environment* env) {
     if (node->assigne->kind != AST::NodeType::Identifier) {
         throw std::runtime_error(fmt::format("Invalid LHS in assignment expression."));
     }
-    auto name = static_cast<AST::Identifier*>(node->assigne)->symbol;
-    return env->assignVar(name, evaluate(node->value, env));
+    auto ident = static_cast<AST::Identifier*>(node->assigne);
+    return env->assignAt(ident->depth, ident->slot, evaluate(node->value, env));
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_fun_declaration(AST::FunDeclare* declaration, Environment* env) {
-    auto fn = std::make_unique<values::FunValue>();
+values::Value interpreter::evaluate_fun_declaration(AST::FunDeclare* declaration, Environment* env) {
+    auto fn = Heap::make<values::FunValue>();
     fn->name = declaration->name;
     fn->params = declaration->parameters;
+    fn->locals = declaration->locals;
     fn->decEnv = env;
     fn->body = declaration->body;
+    fn->captured = declaration->captured;
 
-    return env->declareVar(declaration->name, std::move(fn), true);
+    return env->declareAt(declaration->slot, values::Value::object(fn), true);
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_if_statement(AST::IfStmt* ifstmt, Environment* env) {
-    bool condition = static_cast<values::BoolVal*>(evaluate(ifstmt->condition, env).get())->value;
-
-    bool hasElse = ifstmt->elseStmt.has_value();
-
-    auto lastEvaluated = std::make_unique<values::RuntimeVal>();
+bool interpreter::is_true(values::Value value) {
+    if (value.isBoolean()) return value.asBoolean();
+    if (value.isNumber()) return value.asNumber() != 0;
+    return !value.isNull();
+}
 
-    if (!hasElse) {
-        if (condition) {
-            for (auto& stmt : ifstmt->body) {
-                lastEvaluated = evaluate(stmt, env);
-            }
-            return lastEvaluated;
-        }
-    } else {
-        if (condition) {
-            for (auto& stmt : ifstmt->body) {
-                lastEvaluated = evaluate(stmt, env);
-            }
-            return lastEvaluated;
-        } else {
-            for (auto& stmt : ifstmt->elseStmt.value()->body) {
-                lastEvaluated = evaluate(stmt, env);
-            }
-            return lastEvaluated;
-        }
+values::Value interpreter::evaluate_if_statement(AST::IfStmt* ifstmt, Environment* env) {
+    if (is_true(evaluate(ifstmt->condition, env))) {
+        return evaluate_block(ifstmt->body, env);
     }
-
-    return lastEvaluated;
+    if (ifstmt->elseStmt) {
+        return evaluate_block(ifstmt->elseStmt.value()->body, env);
+    }
+    return values::Value::null();
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_comparison_expr(AST::CompEx* compEx, Environment* env) {
-    auto left = static_cast<values::NumVal*>(evaluate(compEx->left, env).get());
-    auto right = static_cast<values::NumVal*>(evaluate(compEx->right, env).get());
-
-    bool result = false;
+values::Value interpreter::evaluate_comparison_expr(AST::CompEx* compEx, Environment* env) {
+    // objects compare by identity, so the left one has to stay alive while the right is evaluated.
+    auto lhs = evaluate(compEx->left, env);
+    auto rhs = lhs.isObject() ? evaluate_pinned(lhs, compEx->right, env) : evaluate(compEx->right, env);
+    if (lhs.isNumber() && rhs.isNumber() && !compEx->generic) {
+        compEx->kind = AST::NodeType::IntCompExpr;
+    }
+    return apply_comparison(lhs, rhs, compEx->op);
+}
 
-    if (compEx->op == "<") result = left->value < right->value; else
-    if (compEx->op == ">") result = left->value > right->value; else
-    if (compEx->op == "==") result = left->value == right->value; else
-    if (compEx->op == ">=") result = left->value >= right->value; else
-    if (compEx->op == "<=") result = left->value <= right->value;
+values::Value interpreter::evaluate_int_comparison_expr(AST::CompEx* compEx, Environment* env) {
+    auto lhs = evaluate_operand(compEx->left, env);
+    auto rhs = lhs.isObject() ? evaluate_pinned(lhs, compEx->right, env) : evaluate_operand(compEx->right, env);
+    if (!lhs.isNumber() || !rhs.isNumber()) [[unlikely]] {
+        compEx->kind = AST::NodeType::CompExpr;
+        compEx->generic = true;
+        return apply_comparison(lhs, rhs, compEx->op);
+    }
 
+    return values::Value::boolean(numbers::compare(compEx->op, lhs.asNumber(), rhs.asNumber()));
+}
 
-    return utils::MK_BOOL(result);
+values::Value interpreter::apply_comparison(values::Value lhs, values::Value rhs, AST::CompareOp op) {
+    // only numbers order, strings are equal by their text and anything else when it's the same value.
+    if (!lhs.isNumber() || !rhs.isNumber()) {
+        if (op == AST::CompareOp::Equal && lhs.type() == values::ValueType::String && rhs.type() == values::ValueType::String) {
+            return utils::MK_BOOL(lhs.as<values::StringVal>()->text() == rhs.as<values::StringVal>()->text());
+        }
+        return utils::MK_BOOL(op == AST::CompareOp::Equal && lhs == rhs);
+    }
+    return utils::MK_BOOL(numbers::compare(op, lhs.asNumber(), rhs.asNumber()));
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_member_expr(AST::MemberExpr* member, Environment* env) {
+values::Value interpreter::evaluate_member_expr(AST::MemberExpr* member, Environment* env) {
     auto objectVal = evaluate(member->object, env);
 
     auto propertyIdent = static_cast<AST::Identifier*>(member->property);
     if (!propertyIdent) {
         throw std::runtime_error("Interpreter: Property in member expression is not an identifier.");
     }
-    
-    auto propertyName = propertyIdent->symbol;
 
-    if (objectVal->type == values::ValueType::Object) {
-        auto object = static_cast<values::ObjectVal*>(objectVal.get());
+    if (objectVal.type() == values::ValueType::Object && !member->generic) {
+        if (auto value = objectVal.as<values::ObjectVal>()->find(propertyIdent->symbol, member->cache)) {
+            member->kind = AST::NodeType::CachedMemberExpr;
+            return *value;
+        }
+    }
+    return access_member(objectVal, propertyIdent->symbol);
+}
 
-        auto it = object->properties.find(propertyName);
-        if (it != object->properties.end()) {
-            return std::move(it->second);
-        } else {
-            throw std::runtime_error(fmt::format("Property '{}' does not exist on the object.", propertyName));
+// hits while the object has one of the shapes in the cache, a new shape gets added while there's
+// room. once a miss can't be cached (too many shapes, not an object, no such property) the node
+// goes back to being a plain MemberExpr.
+values::Value interpreter::evaluate_cached_member_expr(AST::MemberExpr* member, Environment* env) {
+    auto objectVal = evaluate_operand(member->object, env);
+    auto property = static_cast<AST::Identifier*>(member->property)->symbol;
+    if (objectVal.type() == values::ValueType::Object) {
+        auto object = objectVal.as<values::ObjectVal>();
+        auto slot = member->cache.find(object->shape);
+        if (slot != PropertyCache::NONE) [[likely]] {
+            return object->slot(slot);
+        }
+        if (!member->cache.full()) {
+            if (auto index = object->shape->find(property)) {
+                member->cache.add(object->shape, *index);
+                return object->slot(*index);
+            }
         }
     }
 
-    throw std::runtime_error("Interpreter: Attempted to access a member on a non-object type.");
+    member->kind = AST::NodeType::MemberExpr;
+    member->generic = true;
+    return access_member(objectVal, property);
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_string(AST::StringLiteral* string, Environment* env) {
-    auto stringVal = std::make_unique<values::StringVal>();
-    stringVal->value = string->value;
-    return stringVal;
-}
+values::Value interpreter::access_member(values::Value objectVal, SymbolId propertyName) {
+    if (objectVal.type() == values::ValueType::Object) {
+        if (auto value = objectVal.as<values::ObjectVal>()->find(propertyName)) {
+            return *value;
+        }
+        throw std::runtime_error(fmt::format("Property '{}' does not exist on the object.", Symbols::name(propertyName)));
+    }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate_while_statement(AST::WhileStmt* whilestmt, Environment* env) {
-    std::unique_ptr<values::RuntimeVal> lastEvaluated;
+    throw std::runtime_error("Interpreter: Attempted to access a member on a non-object type.");
+}
 
-    while (true) {
-        auto conditionVal = evaluate(whilestmt->condition, env);
+values::Value interpreter::access_member(values::Value objectVal, SymbolId propertyName, PropertyCache& cache) {
+    if (objectVal.type() == values::ValueType::Object) {
+        if (auto value = objectVal.as<values::ObjectVal>()->find(propertyName, cache)) {
+            return *value;
+        }
+    }
+    return access_member(objectVal, propertyName); // for the error
+}
 
-        bool condition = static_cast<values::BoolVal*>(conditionVal.get())->value;
+values::Value interpreter::evaluate_string(AST::StringLiteral* string, Environment* env) {
+    return utils::MK_STRING_LITERAL(string->value);
+}
 
-        if (!condition) break;
-        try {
-            for (auto& stmt : whilestmt->body) {
-                lastEvaluated = evaluate(stmt, env);
+values::Value interpreter::evaluate_while_statement(AST::WhileStmt* whilestmt, Environment* env) {
+    values::Value lastEvaluated;
+    ArgumentStack::Frame pin(pinned); // lastEvaluated, it's kept across the next condition
+    pin.push(lastEvaluated);
+
+    // the loop's value is the last body statement that finished normally.
+    while (is_true(evaluate(whilestmt->condition, env))) {
+        for (auto stmt : whilestmt->body) {
+            auto value = evaluate(stmt, env);
+            if (completion != Completion::Normal) {
+                if (completion == Completion::Return || completion == Completion::TailCall) {
+                    return value;
+                }
+                break;
             }
-        } catch (const utils::Break&) {
+            lastEvaluated = value;
+            pin.set(0, value);
+        }
+
+        if (completion == Completion::Break) {
+            completion = Completion::Normal;
             break;
         }
+        completion = Completion::Normal;
     }
     return lastEvaluated;
 }
 
-std::unique_ptr<values::RuntimeVal> interpreter::evaluate(AST::Stmt* astNode, Environment* env) {
+values::Value interpreter::evaluate(AST::Stmt* astNode, Environment* env) {
+    stack.check();
     switch (astNode->kind) {
         case AST::NodeType::NumericLiteral: {
-            auto value = std::make_unique<values::NumVal>();
-            value->value = static_cast<AST::NumericLiteral*>(astNode)->value;
-            return value;
+            return values::Value::number(static_cast<AST::NumericLiteral*>(astNode)->value);
         }
         case AST::NodeType::Identifier: {
             return evaluate_identifier(static_cast<AST::Identifier*>(astNode), env);
@@ -257,7 +396,29 @@ std::unique_ptr<values::RuntimeVal> interpreter::evaluate(AST::Stmt* astNode, En
             return evaluate_while_statement(static_cast<AST::WhileStmt*>(astNode), env);
         }
         case AST::NodeType::BreakStmt: {
-            throw utils::Break();
+            completion = Completion::Break;
+            return values::Value::null();
+        }
+        case AST::NodeType::ContinueStmt: {
+            completion = Completion::Continue;
+            return values::Value::null();
+        }
+        case AST::NodeType::IntBinaryExpr: {
+            return evaluate_int_binary_expr(static_cast<AST::BinEx*>(astNode), env);
+        }
+        case AST::NodeType::IntCompExpr: {
+            return evaluate_int_comparison_expr(static_cast<AST::CompEx*>(astNode), env);
+        }
+        case AST::NodeType::CachedMemberExpr: {
+            return evaluate_cached_member_expr(static_cast<AST::MemberExpr*>(astNode), env);
+        }
+        case AST::NodeType::ReturnStmt: {
+            auto returnstmt = static_cast<AST::ReturnStmt*>(astNode);
+            auto value = returnstmt->value ? evaluate(returnstmt->value.value(), env) : values::Value::null();
+            if (completion == Completion::Normal) {
+                completion = Completion::Return; // otherwise it was a tail call, which already says where to go
+            }
+            return value;
         }
         default: {
             std::cout << "Interpreter: This AST has not been yet setup for interpretation." << std::endl; // message mainly for things that i havent implemented in the interpreter yet.
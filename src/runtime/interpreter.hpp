@@ -1,28 +1,91 @@
 #pragma once
-#include <memory> // Include for std::unique_ptr
 #include "values.hpp"
 #include "../frontend/ast.hpp"
+#include "../frontend/flat_ast.hpp"
 #include "environment.hpp"
+#include "arguments.hpp"
+#include "call_depth.hpp"
 
 namespace runtime {
-    class interpreter {
+    // how the last statement finished. anything but Normal stops the statement lists it's in and goes
+    // up to whatever handles it: loops take Break and Continue, calls take Return and TailCall.
+    // the value that came with it (what's returned, the callee of a tail call) is passed up as well.
+    enum class Completion : std::uint8_t {
+        Normal,
+        Break,
+        Continue,
+        Return,
+        TailCall
+    };
+
+    // a root source for the collector: the arguments, the pinned values and the calls in progress.
+    class interpreter : public RootSource {
     private:
-        std::unique_ptr<values::RuntimeVal> evaluate_binary_expr(frontend::AST::BinEx* binop, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_program(frontend::AST::Program* program, Environment* env);
-        std::unique_ptr<values::NumVal> evaluate_numeric_binary_expr(std::unique_ptr<values::NumVal> lhs, std::unique_ptr<values::NumVal> rhs, const std::string& op);
-        std::unique_ptr<values::RuntimeVal> evaluate_var_declaration(frontend::AST::VarDeclare* declaration, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_assignment(frontend::AST::AssignExpr* node, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_identifier(frontend::AST::Identifier* ident, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_object_expr(frontend::AST::ObjectLiteral* obj, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_call_expr(frontend::AST::CallExpr* expr, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_fun_declaration(frontend::AST::FunDeclare* declaration, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_if_statement(frontend::AST::IfStmt* ifstmt, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_comparison_expr(frontend::AST::CompEx* compEx, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_member_expr(frontend::AST::MemberExpr* member, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_string(frontend::AST::StringLiteral* string, Environment* env);
-        std::unique_ptr<values::RuntimeVal> evaluate_while_statement(frontend::AST::WhileStmt* whilestmt, Environment* env);
+        values::Value evaluate_binary_expr(frontend::AST::BinEx* binop, Environment* env);
+        values::Value evaluate_program(frontend::AST::Program* program, Environment* env);
+        values::Value evaluate_block(const frontend::AST::List<frontend::AST::Stmt*>& body, Environment* env);
+        values::Value evaluate_var_declaration(frontend::AST::VarDeclare* declaration, Environment* env);
+        values::Value evaluate_assignment(frontend::AST::AssignExpr* node, Environment* env);
+        values::Value evaluate_identifier(frontend::AST::Identifier* ident, Environment* env);
+        values::Value evaluate_object_expr(frontend::AST::ObjectLiteral* obj, Environment* env);
+        values::Value evaluate_call_expr(frontend::AST::CallExpr* expr, Environment* env);
+        values::Value evaluate_fun_declaration(frontend::AST::FunDeclare* declaration, Environment* env);
+        values::Value evaluate_if_statement(frontend::AST::IfStmt* ifstmt, Environment* env);
+        values::Value evaluate_comparison_expr(frontend::AST::CompEx* compEx, Environment* env);
+        values::Value evaluate_member_expr(frontend::AST::MemberExpr* member, Environment* env);
+        values::Value evaluate_string(frontend::AST::StringLiteral* string, Environment* env);
+        values::Value evaluate_while_statement(frontend::AST::WhileStmt* whilestmt, Environment* env);
+
+        // the specialized nodes. each checks what it was specialized for (its guard) and turns back into
+        // the generic node when that fails, see AST::NodeType.
+        values::Value evaluate_int_binary_expr(frontend::AST::BinEx* binop, Environment* env);
+        values::Value evaluate_int_comparison_expr(frontend::AST::CompEx* compEx, Environment* env);
+        values::Value evaluate_cached_member_expr(frontend::AST::MemberExpr* member, Environment* env);
+        // reads literals and variables without going through evaluate, specialized nodes mostly get those.
+        values::Value evaluate_operand(frontend::AST::Expr* expr, Environment* env);
+
+        // evaluates expr while keeping a value the caller still needs (the left side of a comparison)
+        // reachable, evaluating expr can collect.
+        values::Value evaluate_pinned(values::Value keep, frontend::AST::Expr* expr, Environment* env);
+        values::Value evaluate_pinned(values::Value keep, const frontend::FlatAST& ast, frontend::FlatAST::Index index, Environment* env);
+
+        values::Value call_function(values::Value fn, std::span<const values::Value> args, Environment* env);
+        // a tail call to a script function isn't made here, its arguments go in the current call's tail
+        // frame and the callee is returned with Completion::TailCall for call_function to make instead.
+        values::Value evaluate_tail_call(values::Value callee, Environment* env);
+
+        values::Value evaluate_flat_block(const frontend::FlatAST& ast, std::uint32_t list, Environment* env);
+        values::Value evaluate_flat_block(const frontend::FlatAST& ast, frontend::AST::List<std::uint32_t> body, Environment* env);
+
+        // one inline cache per member site of the flat program being walked, see FlatAST.
+        std::vector<PropertyCache> flatCaches;
+
+        ArgumentStack arguments;
+        // values the collector has to see that are otherwise only in C++ locals, a half built object
+        // say. kept apart from arguments, a tail call rewrites its frame while pins above it are live.
+        ArgumentStack pinned;
+        CallStack calls;
+        ArgumentStack::Frame* tailFrame = nullptr; // of the innermost script call
+        std::uint32_t callDepth = 0;
+        StackLimit stack; // entered by the program node, checked by every node
+        Completion completion = Completion::Normal;
     public:
         interpreter() {}
-        std::unique_ptr<values::RuntimeVal> evaluate(frontend::AST::Stmt* astNode, Environment* env);
+
+        void traceRoots(Tracer& tracer) override;
+
+        // the parts that dont care how the program is stored, shared by the walkers and the vm.
+        static values::Value evaluate_numeric_binary_expr(int lhs, int rhs, frontend::AST::BinaryOp op);
+        // numbers, and + on two strings.
+        static values::Value apply_binary(values::Value lhs, values::Value rhs, frontend::AST::BinaryOp op);
+        static values::Value apply_comparison(values::Value lhs, values::Value rhs, frontend::AST::CompareOp op);
+        static values::Value access_member(values::Value objectVal, frontend::SymbolId property);
+        // the same through a site's inline cache.
+        static values::Value access_member(values::Value objectVal, frontend::SymbolId property, PropertyCache& cache);
+        static bool is_true(values::Value value);
+
+        values::Value evaluate(frontend::AST::Stmt* astNode, Environment* env);
+        // walks the flattened form directly, index is usually ast.root().
+        values::Value evaluate(const frontend::FlatAST& ast, frontend::FlatAST::Index index, Environment* env);
     };
 }
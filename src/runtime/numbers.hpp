@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include "../frontend/ast.hpp"
+
+namespace runtime {
+    // what the operators do to two numbers. every engine and the constant folder get it from here, so the
+    // number semantics only live in one place. the templates are for code that knows the operator when it's
+    // compiled (the vm's opcodes, the closure engine's nodes), the overloads taking an op switch to them.
+    namespace numbers {
+        // + - and * wrap around instead of overflowing, that would be undefined.
+        template <frontend::AST::BinaryOp OP>
+        inline int arithmetic(int left, int right) {
+            auto a = static_cast<std::uint32_t>(left);
+            auto b = static_cast<std::uint32_t>(right);
+            if constexpr (OP == frontend::AST::BinaryOp::Add) return static_cast<int>(a + b);
+            else if constexpr (OP == frontend::AST::BinaryOp::Sub) return static_cast<int>(a - b);
+            else if constexpr (OP == frontend::AST::BinaryOp::Mul) return static_cast<int>(a * b);
+            else if constexpr (OP == frontend::AST::BinaryOp::Div) return left / right;
+            else return left % right;
+        }
+
+        template <frontend::AST::CompareOp OP>
+        inline bool compare(int left, int right) {
+            if constexpr (OP == frontend::AST::CompareOp::Less) return left < right;
+            else if constexpr (OP == frontend::AST::CompareOp::Greater) return left > right;
+            else if constexpr (OP == frontend::AST::CompareOp::Equal) return left == right;
+            else if constexpr (OP == frontend::AST::CompareOp::GreaterEqual) return left >= right;
+            else return left <= right;
+        }
+
+        inline int arithmetic(frontend::AST::BinaryOp op, int left, int right) {
+            switch (op) {
+                case frontend::AST::BinaryOp::Add: return arithmetic<frontend::AST::BinaryOp::Add>(left, right);
+                case frontend::AST::BinaryOp::Sub: return arithmetic<frontend::AST::BinaryOp::Sub>(left, right);
+                case frontend::AST::BinaryOp::Mul: return arithmetic<frontend::AST::BinaryOp::Mul>(left, right);
+                case frontend::AST::BinaryOp::Div: return arithmetic<frontend::AST::BinaryOp::Div>(left, right);
+                default: return arithmetic<frontend::AST::BinaryOp::Mod>(left, right);
+            }
+        }
+
+        inline bool compare(frontend::AST::CompareOp op, int left, int right) {
+            switch (op) {
+                case frontend::AST::CompareOp::Less: return compare<frontend::AST::CompareOp::Less>(left, right);
+                case frontend::AST::CompareOp::Greater: return compare<frontend::AST::CompareOp::Greater>(left, right);
+                case frontend::AST::CompareOp::Equal: return compare<frontend::AST::CompareOp::Equal>(left, right);
+                case frontend::AST::CompareOp::GreaterEqual: return compare<frontend::AST::CompareOp::GreaterEqual>(left, right);
+                default: return compare<frontend::AST::CompareOp::LessEqual>(left, right);
+            }
+        }
+    }
+}
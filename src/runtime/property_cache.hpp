@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+namespace runtime {
+    class Shape;
+
+    // the inline cache of one property access site (obj.x somewhere in the program): the shapes the
+    // site has seen and which slot objects of each shape keep the property in. holds up to WAYS shapes,
+    // a site that sees more is megamorphic and leaves the rest to a plain lookup.
+    //
+    // kept free of any other runtime header so the AST can hold one for the tree walker.
+    struct PropertyCache {
+        static constexpr std::uint8_t WAYS = 4;
+        static constexpr std::uint32_t NONE = 0xFFFFFFFF;
+
+        const Shape* shapes[WAYS] = {};
+        std::uint32_t slots[WAYS] = {};
+        std::uint8_t count = 0;
+
+        std::uint32_t find(const Shape* shape) const {
+            for (std::uint8_t i = 0; i < count; ++i) {
+                if (shapes[i] == shape) return slots[i];
+            }
+            return NONE;
+        }
+        bool full() const {
+            return count == WAYS;
+        }
+        void add(const Shape* shape, std::uint32_t slot) {
+            shapes[count] = shape;
+            slots[count] = slot;
+            ++count;
+        }
+    };
+}
@@ -0,0 +1,55 @@
+#include "shape.hpp"
+
+using namespace runtime;
+
+namespace {
+    std::size_t made = 1; // the empty shape
+}
+
+Shape* Shape::empty() {
+    static Shape* root = new Shape(std::make_shared<Layout>());
+    return root;
+}
+
+std::size_t Shape::shapeCount() {
+    return made;
+}
+
+std::optional<std::uint32_t> Shape::find(frontend::SymbolId key) const {
+    auto& keys = layout->keys;
+    if (count <= LINEAR_LIMIT) {
+        for (std::uint32_t slot = 0; slot < count; ++slot) {
+            if (keys[slot] == key) return slot;
+        }
+        return std::nullopt;
+    }
+
+    // the index catches up with keys the shared layout got since it was last used.
+    auto& index = layout->index;
+    for (auto slot = static_cast<std::uint32_t>(index.size()); slot < keys.size(); ++slot) {
+        index.emplace(keys[slot], slot);
+    }
+    auto it = index.find(key);
+    if (it == index.end() || it->second >= count) return std::nullopt;
+    return it->second;
+}
+
+Shape* Shape::with(frontend::SymbolId key) {
+    auto it = transitions.find(key);
+    if (it != transitions.end()) {
+        return it->second.get();
+    }
+
+    std::unique_ptr<Shape> next;
+    if (layout->keys.size() == count) {
+        next.reset(new Shape(layout)); // nothing has grown past this shape yet, the child can keep going in it
+    } else {
+        next.reset(new Shape(std::make_shared<Layout>()));
+        next->layout->keys.assign(layout->keys.begin(), layout->keys.begin() + count);
+    }
+    next->layout->keys.push_back(key);
+    next->count = count + 1;
+    ++made;
+
+    return transitions.emplace(key, std::move(next)).first->second.get();
+}
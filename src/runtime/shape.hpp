@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "../frontend/symbols.hpp"
+
+namespace runtime {
+    // a hidden class: which properties an object has and the slot each one is in. objects that got the
+    // same keys in the same order share one shape, so they only store their values and a property
+    // site can remember the slot per shape instead of looking the name up every time.
+    //
+    // shapes form a tree from empty(), adding a key moves an object to the child for that key. they're
+    // made once and never freed. a shape and the ancestors it was grown from share one key list (and
+    // the hash index over it), a branch only copies the keys it has in common with its parent.
+    class Shape {
+    public:
+        // the shape every object starts out with, no properties.
+        static Shape* empty();
+
+        std::uint32_t size() const {
+            return count;
+        }
+        frontend::SymbolId key(std::uint32_t slot) const {
+            return layout->keys[slot];
+        }
+        std::optional<std::uint32_t> find(frontend::SymbolId key) const;
+        // the shape an object of this one has once key is added, key gets slot size().
+        Shape* with(frontend::SymbolId key);
+
+        // how many shapes have been made so far.
+        static std::size_t shapeCount();
+    private:
+        // keys are unique along a chain of shapes, so one index serves all of them, a key whose slot is
+        // past a shape's count just isn't in that shape.
+        struct Layout {
+            std::vector<frontend::SymbolId> keys;
+            std::unordered_map<frontend::SymbolId, std::uint32_t> index; // filled in lazily, see find()
+        };
+
+        // small shapes are searched through directly, the index is only worth it past this.
+        static constexpr std::uint32_t LINEAR_LIMIT = 8;
+
+        explicit Shape(std::shared_ptr<Layout> layout) : layout(std::move(layout)) {}
+
+        std::shared_ptr<Layout> layout;
+        std::uint32_t count = 0;
+        std::unordered_map<frontend::SymbolId, std::unique_ptr<Shape>> transitions;
+    };
+}
@@ -0,0 +1,18 @@
+#include "slab.hpp"
+
+using namespace runtime;
+
+void SlabAllocator::refill(std::size_t sizeClass) {
+    auto blockSize = (sizeClass + 1) * GRANULE;
+    auto slab = static_cast<char*>(::operator new(SLAB_SIZE));
+    pools.slabs++;
+
+    // threaded back to front so blocks come out in address order.
+    Block* list = pools.free[sizeClass];
+    for (auto offset = (SLAB_SIZE / blockSize) * blockSize; offset > 0; offset -= blockSize) {
+        auto block = reinterpret_cast<Block*>(slab + offset - blockSize);
+        block->next = list;
+        list = block;
+    }
+    pools.free[sizeClass] = list;
+}
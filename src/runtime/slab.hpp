@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// under AddressSanitizer every block comes straight from operator new, so it still sees a use after
+// the collector freed something.
+#if defined(__SANITIZE_ADDRESS__)
+    #define YHS_SLAB_BYPASS
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define YHS_SLAB_BYPASS
+    #endif
+#endif
+
+namespace runtime {
+    // size-class pools for heap values and scopes (see HeapObject's operator new). sizes are rounded up
+    // to a multiple of GRANULE and each class hands out blocks from its own free list, which is
+    // refilled a whole slab at a time. anything over MAX_SIZE goes to the global operator new.
+    //
+    // the free lists are per thread, a block has to be freed on the thread that made it (the heap is
+    // only used from one anyway). slabs are kept for the life of the process, freed blocks just go
+    // back on their list.
+    class SlabAllocator {
+    public:
+        static constexpr std::size_t GRANULE = 16;
+        static constexpr std::size_t MAX_SIZE = 256;
+        static constexpr std::size_t SLAB_SIZE = 64 * 1024;
+#ifdef YHS_SLAB_BYPASS
+        static constexpr bool POOLED = false;
+#else
+        static constexpr bool POOLED = true;
+#endif
+
+        static void* allocate(std::size_t size) {
+            if (!POOLED || size > MAX_SIZE) [[unlikely]] return ::operator new(size);
+            auto& list = pools.free[sizeClass(size)];
+            if (!list) [[unlikely]] refill(sizeClass(size));
+            auto block = list;
+            list = block->next;
+            return block;
+        }
+        static void deallocate(void* pointer, std::size_t size) {
+            if (!POOLED || size > MAX_SIZE) [[unlikely]] {
+                ::operator delete(pointer);
+                return;
+            }
+            auto block = static_cast<Block*>(pointer);
+            auto& list = pools.free[sizeClass(size)];
+            block->next = list;
+            list = block;
+        }
+
+        // bytes taken from the system for slabs by this thread so far.
+        static std::size_t reservedBytes() {
+            return pools.slabs * SLAB_SIZE;
+        }
+    private:
+        static constexpr std::size_t CLASS_COUNT = MAX_SIZE / GRANULE;
+
+        struct Block {
+            Block* next;
+        };
+        // plain data, so the thread local needs no constructor or destructor. blocks are still handed
+        // back while the heap is torn down at exit.
+        struct Pools {
+            Block* free[CLASS_COUNT];
+            std::size_t slabs;
+        };
+
+        static std::size_t sizeClass(std::size_t size) {
+            return (size + GRANULE - 1) / GRANULE - 1;
+        }
+        // carves a new slab into blocks of that class.
+        static void refill(std::size_t sizeClass);
+
+        static inline thread_local Pools pools = {};
+    };
+}
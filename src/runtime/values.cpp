@@ -0,0 +1,55 @@
+#include "values.hpp"
+#include "heap.hpp"
+
+using namespace runtime;
+
+values::Value values::StringVal::concat(Value lhs, Value rhs) {
+    auto left = lhs.as<StringVal>();
+    auto right = rhs.as<StringVal>();
+    if (right->size == 0) return lhs;
+    if (left->size == 0) return rhs;
+    auto size = left->size + right->size;
+
+    if (left->buffer && !left->left && left->buffer->size() == left->size) {
+        auto buffer = left->buffer; // left can be collected while the result is made
+        if (right->buffer == buffer) {
+            std::string copy(right->text()); // s + s, appending would read what it moves
+            buffer->append(copy);
+        } else {
+            buffer->append(right->text());
+        }
+        return Value::object(Heap::make<StringVal>(std::move(buffer), size));
+    }
+
+    if (size <= FLAT_LIMIT) {
+        std::string text;
+        text.reserve(size);
+        text.append(left->text());
+        text.append(right->text());
+        return Value::object(Heap::make<StringVal>(std::move(text)));
+    }
+    LocalRoots<2> roots(lhs, rhs);
+    return Value::object(Heap::make<StringVal>(left, right));
+}
+
+// walks the rope with a stack of its own, a string prepended to in a loop is a very deep tree.
+void values::StringVal::flatten() const {
+    std::string text;
+    text.reserve(size);
+    std::vector<const StringVal*> pending = {this};
+    while (!pending.empty()) {
+        auto node = pending.back();
+        pending.pop_back();
+        if (node->left) {
+            pending.push_back(node->right);
+            pending.push_back(node->left);
+        } else {
+            text.append(node->text());
+        }
+    }
+
+    // the halves aren't needed anymore, the collector can have them unless something else holds them.
+    buffer = std::make_shared<std::string>(std::move(text));
+    left = nullptr;
+    right = nullptr;
+}
@@ -2,12 +2,28 @@
 #include <string>
 #include <unordered_map>
 #include <functional>
-#include <deque>
+#include <vector>
+#include <span>
+#include <cstdint>
 #include "../frontend/ast.hpp"
+#include "heap_object.hpp"
+#include "shape.hpp"
+#include "property_cache.hpp"
 #include <memory>
 
+namespace frontend {
+    class FlatAST;
+}
+
 namespace runtime {
     class Environment;
+    namespace bytecode {
+        struct Function;
+    }
+    namespace closure {
+        struct Code;
+    }
+
     class values {
     public:
         values() = delete;
@@ -21,46 +37,133 @@ namespace runtime {
             String, // 6
         };
 
-        struct RuntimeVal {
+        // base of everything that has to live on the heap (objects, functions, strings).
+        struct RuntimeVal : public HeapObject {
             RuntimeVal() {}
-            virtual ~RuntimeVal() = default;
 
             ValueType type;
         };
 
-        struct NullVal : public RuntimeVal {
-            NullVal() {
-                type = ValueType::Null;
+        // what the interpreter passes around: 64 bits, numbers, booleans and null are stored inline and
+        // only heap values are a pointer. laid out like a NaN-box, every tag sits in the quiet NaN space
+        // so a plain double could be added later without changing the other encodings.
+        struct Value {
+            std::uint64_t bits;
+
+            static constexpr std::uint64_t TAG_MASK = 0xFFFF000000000000ull;
+            static constexpr std::uint64_t NULL_TAG = 0x7FF9000000000000ull;
+            static constexpr std::uint64_t BOOL_TAG = 0x7FFA000000000000ull;
+            static constexpr std::uint64_t NUMBER_TAG = 0x7FFB000000000000ull;
+            static constexpr std::uint64_t POINTER_TAG = 0xFFF9000000000000ull; // pointers get the low 48 bits
+            static constexpr std::uint64_t PAYLOAD_MASK = ~TAG_MASK;
+
+            constexpr Value() : bits(NULL_TAG) {}
+
+            static constexpr Value null() {
+                return Value();
+            }
+            static constexpr Value number(int value) {
+                return Value(NUMBER_TAG | static_cast<std::uint32_t>(value));
+            }
+            static constexpr Value boolean(bool value) {
+                return Value(BOOL_TAG | static_cast<std::uint64_t>(value));
+            }
+            static Value object(RuntimeVal* object) {
+                return Value(POINTER_TAG | (reinterpret_cast<std::uintptr_t>(object) & PAYLOAD_MASK));
             }
 
-            std::nullptr_t value = nullptr;
-        };
+            constexpr bool isNull() const { return bits == NULL_TAG; }
+            constexpr bool isNumber() const { return (bits & TAG_MASK) == NUMBER_TAG; }
+            constexpr bool isBoolean() const { return (bits & TAG_MASK) == BOOL_TAG; }
+            constexpr bool isObject() const { return (bits & TAG_MASK) == POINTER_TAG; }
 
-        struct NumVal : public RuntimeVal {
-            NumVal() {
-                type = ValueType::Number;
+            constexpr int asNumber() const { return static_cast<int>(static_cast<std::uint32_t>(bits)); }
+            constexpr bool asBoolean() const { return (bits & 1) != 0; }
+            RuntimeVal* asObject() const { return reinterpret_cast<RuntimeVal*>(static_cast<std::uintptr_t>(bits & PAYLOAD_MASK)); }
+            // unchecked, look at type() first.
+            template <typename T>
+            T* as() const { return static_cast<T*>(asObject()); }
+
+            ValueType type() const {
+                switch (bits & TAG_MASK) {
+                    case NUMBER_TAG: return ValueType::Number;
+                    case BOOL_TAG: return ValueType::Boolean;
+                    case POINTER_TAG: return asObject()->type;
+                    default: return ValueType::Null;
+                }
             }
 
-            int value;
+            constexpr bool operator==(const Value& other) const = default;
+        private:
+            constexpr explicit Value(std::uint64_t bits) : bits(bits) {}
         };
+        static_assert(sizeof(Value) == 8);
 
-        struct BoolVal : public RuntimeVal {
-            BoolVal() {
-                type = ValueType::Boolean;
+        // the write barrier, every store of a value into a heap object or a scope goes through it.
+        static void barrier(Value value) {
+            if (HeapObject::barrierActive && value.isObject()) [[unlikely]] {
+                HeapObject::shade(value.asObject());
             }
+        }
 
-            bool value;
-        };
-    
+        // the keys live in the shape, the object only keeps the values, by slot. the first few are
+        // inline, most objects are small records.
         struct ObjectVal : public RuntimeVal {
+            static constexpr std::uint32_t INLINE_SLOTS = 4;
+
             ObjectVal() {
                 type = ValueType::Object;
             }
 
-            std::unordered_map<std::string, std::unique_ptr<RuntimeVal>> properties;
+            void trace(Tracer& tracer) override;
+
+            Shape* shape = Shape::empty();
+            Value inlineSlots[INLINE_SLOTS];
+            std::vector<Value> spilled; // slots INLINE_SLOTS and up
+
+            Value& slot(std::uint32_t index) {
+                return index < INLINE_SLOTS ? inlineSlots[index] : spilled[index - INLINE_SLOTS];
+            }
+            const Value& slot(std::uint32_t index) const {
+                return index < INLINE_SLOTS ? inlineSlots[index] : spilled[index - INLINE_SLOTS];
+            }
+
+            // room for count properties, so an object literal grows its storage once.
+            void reserve(std::uint32_t count) {
+                if (count > INLINE_SLOTS) spilled.reserve(count - INLINE_SLOTS);
+            }
+            // adds a property unless there already is one with that key, object literals keep the first.
+            void define(frontend::SymbolId key, Value value) {
+                if (shape->find(key)) return;
+                barrier(value);
+                auto index = shape->size();
+                shape = shape->with(key);
+                if (index >= INLINE_SLOTS) {
+                    spilled.push_back(value);
+                } else {
+                    inlineSlots[index] = value;
+                }
+            }
+
+            const Value* find(frontend::SymbolId key) const {
+                auto index = shape->find(key);
+                return index ? &slot(*index) : nullptr;
+            }
+            // same, through the inline cache of the site doing the lookup.
+            const Value* find(frontend::SymbolId key, PropertyCache& cache) const {
+                auto cached = cache.find(shape);
+                if (cached != PropertyCache::NONE) [[likely]] {
+                    return &slot(cached);
+                }
+                auto index = shape->find(key);
+                if (!index) return nullptr;
+                if (!cache.full()) cache.add(shape, *index);
+                return &slot(*index);
+            }
         };
 
-        using FunctionCall = std::function<std::unique_ptr<values::RuntimeVal>(std::deque<std::shared_ptr<values::RuntimeVal>>, runtime::Environment*)>;
+        // args is a view into the caller's argument stack, only valid for the duration of the call.
+        using FunctionCall = std::function<Value(std::span<const Value>, runtime::Environment*)>;
 
         struct NativeFnValue : public RuntimeVal {
             NativeFnValue() {
@@ -75,16 +178,80 @@ namespace runtime {
                 type = ValueType::Function;
             }
 
-            std::string name;
-            std::deque<std::string> params;
+            void trace(Tracer& tracer) override;
+
+            frontend::SymbolId name;
+            frontend::AST::List<frontend::SymbolId> params; // all three point into the declaring program
+            frontend::AST::List<frontend::SymbolId> locals; // slot names of a call's scope, params first
             Environment* decEnv;
-            std::deque<frontend::AST::Stmt*> body;
+            // declares functions of its own, which keep a call's scope around after it returns, so the
+            // engines give its calls a scope on the heap instead of their usual stack or pooled one.
+            bool captured = false;
+            frontend::AST::List<frontend::AST::Stmt*> body;
+            // set instead of body when the function was declared by the flat walker
+            const frontend::FlatAST* flat = nullptr;
+            frontend::AST::List<std::uint32_t> flatBody;
+            // set instead when the vm made it
+            const bytecode::Function* compiled = nullptr;
+            // or when it was made by closure compiled code
+            const closure::Code* closureBody = nullptr;
         };
 
+        // a string's text is one of:
+        // - a prefix of a buffer it shares. appending to a string that ends where its buffer does grows
+        //   the buffer in place (amortized, like a vector) and the result shares it, the old string
+        //   still reads its own prefix. so building a string up with + in a loop doesn't copy it.
+        // - a view of text that outlives it, a literal in the program's storage.
+        // - a rope node, the concatenation of two other strings, for when the buffer can't be grown
+        //   (prepending, or appending to a string that isn't at the end of its buffer anymore). it's
+        //   only joined into a buffer of its own once something reads it.
         struct StringVal : public RuntimeVal {
-            StringVal() {type = ValueType::String;}
+            using Buffer = std::shared_ptr<std::string>;
+
+            // short concatenations that can't grow a buffer are copied into a new one right away, a rope
+            // node isn't worth it for those.
+            static constexpr std::size_t FLAT_LIMIT = 64;
+
+            struct Literal {
+                std::string_view text;
+            };
+
+            explicit StringVal(std::string text) : buffer(std::make_shared<std::string>(std::move(text))) {
+                type = ValueType::String;
+                size = buffer->size();
+            }
+            StringVal(Buffer buffer, std::size_t size) : buffer(std::move(buffer)), size(size) {
+                type = ValueType::String;
+            }
+            explicit StringVal(Literal literal) : literal(literal.text), size(literal.text.size()) {
+                type = ValueType::String;
+            }
+            StringVal(StringVal* left, StringVal* right) : left(left), right(right), size(left->size + right->size) {
+                type = ValueType::String;
+            }
+
+            void trace(Tracer& tracer) override;
+
+            // flattens a rope first. the view is only good until the next concatenation, that can move
+            // the buffer.
+            std::string_view text() const {
+                if (left) [[unlikely]] flatten();
+                return buffer ? std::string_view(buffer->data(), size) : literal;
+            }
+            std::size_t length() const {
+                return size;
+            }
+
+            // lhs + rhs, both strings. making the result can collect.
+            static Value concat(Value lhs, Value rhs);
+        private:
+            void flatten() const;
 
-            std::string value;
+            mutable Buffer buffer;
+            std::string_view literal;
+            mutable StringVal* left = nullptr; // both set for a rope node that hasn't been read yet
+            mutable StringVal* right = nullptr;
+            std::size_t size = 0;
         };
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,218 @@
+#include "vm.hpp"
+#include <stdexcept>
+#include "heap.hpp"
+#include "interpreter.hpp"
+#include "call_depth.hpp"
+#include "numbers.hpp"
+
+using namespace runtime;
+using namespace frontend;
+using bytecode::Op;
+
+namespace {
+    // numbers are handled right here, anything else goes through the same helper the walker uses.
+    template <AST::BinaryOp OP>
+    inline values::Value arithmetic(values::Value lhs, values::Value rhs) {
+        if (lhs.isNumber() && rhs.isNumber()) {
+            return values::Value::number(numbers::arithmetic<OP>(lhs.asNumber(), rhs.asNumber()));
+        }
+        return interpreter::apply_binary(lhs, rhs, OP);
+    }
+
+    template <AST::CompareOp OP>
+    inline values::Value comparison(values::Value lhs, values::Value rhs) {
+        if (lhs.isNumber() && rhs.isNumber()) {
+            return values::Value::boolean(numbers::compare<OP>(lhs.asNumber(), rhs.asNumber()));
+        }
+        return interpreter::apply_comparison(lhs, rhs, OP);
+    }
+}
+
+void VM::traceRoots(Tracer& tracer) {
+    for (auto value : stack) {
+        tracer.mark(value);
+    }
+    for (auto& frame : frames) {
+        tracer.mark(frame.env);
+    }
+}
+
+values::Value VM::run(const bytecode::Module& module, Environment* env) {
+    const auto* constants = module.constants.data();
+    env->layout(module.globals);
+    caches.assign(module.memberSites, PropertyCache());
+    frames.push_back({&module.main(), module.main().code.data(), env, stack.size(), false});
+    const std::uint8_t* ip = frames.back().ip;
+
+    auto operand = [&ip]() {
+        auto value = bytecode::readOperand(ip);
+        ip += bytecode::OPERAND_SIZE;
+        return value;
+    };
+    auto pop = [this]() {
+        auto value = stack.back();
+        stack.pop_back();
+        return value;
+    };
+
+    while (true) {
+        switch (static_cast<Op>(*ip++)) {
+            case Op::Constant: {
+                stack.push_back(constants[operand()]);
+                break;
+            }
+            case Op::Null: {
+                stack.push_back(values::Value::null());
+                break;
+            }
+            case Op::Pop: {
+                stack.pop_back();
+                break;
+            }
+            case Op::Replace: {
+                stack[stack.size() - 2] = stack.back();
+                stack.pop_back();
+                break;
+            }
+            case Op::GetVar: {
+                auto depth = operand();
+                stack.push_back(env->lookupAt(depth, operand()));
+                break;
+            }
+            case Op::SetVar: {
+                auto depth = operand();
+                env->assignAt(depth, operand(), stack.back());
+                break;
+            }
+            case Op::DeclareVar: {
+                env->declareAt(operand(), stack.back(), false);
+                break;
+            }
+            case Op::DeclareConst: {
+                env->declareAt(operand(), stack.back(), true);
+                break;
+            }
+            case Op::NewObject: {
+                stack.push_back(values::Value::object(Heap::make<values::ObjectVal>()));
+                break;
+            }
+            case Op::SetProperty: {
+                auto key = operand();
+                auto value = pop();
+                stack.back().as<values::ObjectVal>()->define(key, value);
+                break;
+            }
+            case Op::GetMember: {
+                auto property = operand();
+                stack.back() = interpreter::access_member(stack.back(), property, caches[operand()]);
+                break;
+            }
+            case Op::Add: { auto rhs = pop(); stack.back() = arithmetic<AST::BinaryOp::Add>(stack.back(), rhs); break; }
+            case Op::Sub: { auto rhs = pop(); stack.back() = arithmetic<AST::BinaryOp::Sub>(stack.back(), rhs); break; }
+            case Op::Mul: { auto rhs = pop(); stack.back() = arithmetic<AST::BinaryOp::Mul>(stack.back(), rhs); break; }
+            case Op::Div: { auto rhs = pop(); stack.back() = arithmetic<AST::BinaryOp::Div>(stack.back(), rhs); break; }
+            case Op::Mod: { auto rhs = pop(); stack.back() = arithmetic<AST::BinaryOp::Mod>(stack.back(), rhs); break; }
+            case Op::Less: { auto rhs = pop(); stack.back() = comparison<AST::CompareOp::Less>(stack.back(), rhs); break; }
+            case Op::Greater: { auto rhs = pop(); stack.back() = comparison<AST::CompareOp::Greater>(stack.back(), rhs); break; }
+            case Op::Equal: { auto rhs = pop(); stack.back() = comparison<AST::CompareOp::Equal>(stack.back(), rhs); break; }
+            case Op::GreaterEqual: { auto rhs = pop(); stack.back() = comparison<AST::CompareOp::GreaterEqual>(stack.back(), rhs); break; }
+            case Op::LessEqual: { auto rhs = pop(); stack.back() = comparison<AST::CompareOp::LessEqual>(stack.back(), rhs); break; }
+            case Op::Jump: {
+                auto offset = static_cast<std::int32_t>(operand());
+                ip += offset;
+                break;
+            }
+            case Op::JumpIfFalse: {
+                auto offset = static_cast<std::int32_t>(operand());
+                if (!interpreter::is_true(pop())) {
+                    ip += offset;
+                }
+                break;
+            }
+            case Op::Closure: {
+                auto fn = Heap::make<values::FunValue>();
+                fn->compiled = module.functions[operand()].get();
+                fn->name = fn->compiled->name;
+                fn->decEnv = env;
+                stack.push_back(values::Value::object(fn));
+                break;
+            }
+            case Op::Call:
+            case Op::TailCall: {
+                bool tail = static_cast<Op>(ip[-1]) == Op::TailCall;
+                auto argc = operand();
+                // the callee stays on the stack until its scope is set up, a heap scope can collect.
+                auto callee = stack.back();
+                auto args = std::span<const values::Value>(stack).last(argc + 1).first(argc);
+
+                if (callee.type() == values::ValueType::NativeFn) {
+                    auto result = callee.as<values::NativeFnValue>()->call(args, env);
+                    stack.resize(stack.size() - argc - 1);
+                    stack.push_back(result);
+                    break;
+                }
+                if (callee.type() != values::ValueType::Function) {
+                    throw std::runtime_error("Interpreter: Cannot call value that is not a function.");
+                }
+
+                // every call gets a fresh scope under the one the function was declared in. missing
+                // arguments are null, extra ones are dropped. a tail call resets the current frame's
+                // scope for it instead, the resolver made sure nothing else holds on to that scope.
+                //
+                // captured functions get a heap scope, their nested functions can keep it. only calls
+                // from functions that aren't captured can be tail calls, so that frame's is pooled.
+                auto fn = callee.as<values::FunValue>();
+                bool pooled = !fn->compiled->captured;
+                Environment* scope;
+                if (!tail && frames.size() > MAX_CALL_DEPTH) {
+                    callDepthExceeded();
+                }
+                if (tail && pooled) {
+                    scope = frames.back().env;
+                } else if (pooled) {
+                    if (scopesInUse == scopes.size()) {
+                        scopes.push_back(std::make_unique<Environment>(nullptr));
+                    }
+                    scope = scopes[scopesInUse++].get();
+                } else {
+                    scope = Heap::make<Environment>(nullptr);
+                    if (tail) --scopesInUse;
+                }
+                scope->reset(fn->decEnv, fn->compiled->locals);
+                for (std::uint32_t i = 0; i < fn->compiled->paramCount; ++i) {
+                    scope->declareAt(i, i < argc ? args[i] : values::Value::null(), false);
+                }
+
+                if (tail) {
+                    stack.resize(frames.back().base);
+                    frames.back().function = fn->compiled;
+                    frames.back().env = scope;
+                    frames.back().pooled = pooled;
+                    ip = fn->compiled->code.data();
+                } else {
+                    stack.resize(stack.size() - argc - 1);
+                    frames.back().ip = ip;
+                    ip = fn->compiled->code.data();
+                    frames.push_back({fn->compiled, ip, scope, stack.size(), pooled});
+                }
+                env = scope;
+                break;
+            }
+            case Op::Return: {
+                auto result = pop();
+                stack.resize(frames.back().base);
+                bool pooled = frames.back().pooled;
+                frames.pop_back();
+                if (frames.empty()) {
+                    return result;
+                }
+                if (pooled) --scopesInUse;
+
+                env = frames.back().env;
+                ip = frames.back().ip;
+                stack.push_back(result);
+                break;
+            }
+        }
+    }
+}
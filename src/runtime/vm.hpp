@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "bytecode.hpp"
+#include "environment.hpp"
+#include "heap.hpp"
+
+namespace runtime {
+    // runs a compiled module. script calls push a frame instead of recursing, so the whole program
+    // runs in one dispatch loop over one value stack. the value stack and the frames' scopes are its
+    // roots for the collector.
+    class VM : public RootSource {
+    public:
+        VM() {
+            stack.reserve(256);
+        }
+        values::Value run(const bytecode::Module& module, Environment* env);
+
+        void traceRoots(Tracer& tracer) override;
+    private:
+        struct CallFrame {
+            const bytecode::Function* function;
+            const std::uint8_t* ip;
+            // one of scopes for most script calls, a heap scope for captured functions and the global
+            // scope for the top level.
+            Environment* env;
+            std::size_t base; // stack size when the frame started
+            bool pooled;
+        };
+
+        std::vector<values::Value> stack;
+        std::vector<CallFrame> frames;
+        // call scopes get reused instead of allocated per call, the first scopesInUse are taken.
+        std::vector<std::unique_ptr<Environment>> scopes;
+        std::size_t scopesInUse = 0;
+        std::vector<PropertyCache> caches; // by member site
+    };
+}
@@ -5,70 +5,174 @@
 #include <sstream>
 #include <algorithm>
 #include <filesystem>
+#include <iostream>
+#include <cstring>
 #include <fmt/core.h>
 #include "utils.hpp"
+#include "runtime/heap.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 using namespace runtime;
 
 namespace utils {
-    bool isAlpha(const std::string& str) {
-        for (char ch : str) {
-            if (!std::isalpha(static_cast<unsigned char>(ch))) {
-                return false;
+    bool isAlpha(char ch) {
+        return std::isalpha(static_cast<unsigned char>(ch));
+    }
+
+    bool isInt(char ch) {
+        return ch >= '0' && ch <= '9';
+    }
+
+    bool isSkippable(char ch) {
+        return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+    }
+
+    namespace {
+        std::string readStream(std::istream& in) {
+            std::string buffer;
+            char chunk[64 * 1024];
+            while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+                buffer.append(chunk, static_cast<std::size_t>(in.gcount()));
             }
+            return buffer;
         }
-        return true;
-    }
 
-    bool isInt(const std::string& str) {
-        try {
-            auto num = std::stoi(str); // useless value!
-            return true;
-        } catch (...) {
-            return false;
+        // maps regular, non-empty files. returns nullptr for anything else so the caller falls back to reading it.
+        const char* mapFile(const std::string& filePath, std::size_t& size) {
+#ifdef _WIN32
+            HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+            LARGE_INTEGER fileSize;
+            if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+                CloseHandle(file);
+                return nullptr;
+            }
+
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file);
+            if (!mapping) return nullptr;
+
+            // the view keeps the mapping object alive, so the handle can go right away.
+            auto view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+            if (!view) return nullptr;
+
+            size = static_cast<std::size_t>(fileSize.QuadPart);
+            return view;
+#else
+            int fd = open(filePath.c_str(), O_RDONLY);
+            if (fd < 0) return nullptr;
+
+            struct stat info;
+            if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+                close(fd);
+                return nullptr;
+            }
+
+            void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (view == MAP_FAILED) return nullptr;
+
+            madvise(view, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+
+            size = static_cast<std::size_t>(info.st_size);
+            return static_cast<const char*>(view);
+#endif
         }
     }
 
-    bool isSkippable(const std::string& str) {
-        return str == "" || str == " " || str == "\n" || str == "\r" || str == "\t";
+    File::~File() {
+        if (!mapped) return;
+#ifdef _WIN32
+        UnmapViewOfFile(contents.data());
+#else
+        munmap(const_cast<char*>(contents.data()), contents.size());
+#endif
     }
 
-    File* readFile(const std::string& filePath) {
+    std::unique_ptr<File> readFile(const std::string& filePath) {
+        if (filePath == "-") {
+            return std::make_unique<File>(readStream(std::cin), "<stdin>");
+        }
+
         std::string fileName = std::filesystem::path(filePath).filename().string();
-        std::ifstream file(filePath);
+
+        std::size_t size = 0;
+        if (auto mapped = mapFile(filePath, size)) {
+            return std::make_unique<File>(mapped, size, fileName);
+        }
+
+        std::ifstream file(filePath, std::ios::binary);
         if (!file.is_open()) {
-            return new File("", fileName);
+            return std::make_unique<File>("", fileName);
+        }
+        return std::make_unique<File>(readStream(file), fileName);
+    }
+
+    std::uint64_t hashBytes(std::string_view bytes) {
+        constexpr std::uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+        std::uint64_t hash = 0xCBF29CE484222325ull ^ (bytes.size() * multiplier);
+
+        auto mix = [&](std::uint64_t word) {
+            hash ^= word * multiplier;
+            hash = (hash << 31) | (hash >> 33);
+            hash *= 0xBF58476D1CE4E5B9ull;
+        };
+
+        std::size_t i = 0;
+        for (; i + 8 <= bytes.size(); i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes.data() + i, sizeof(word));
+            mix(word);
+        }
+
+        std::uint64_t tail = 0;
+        if (i < bytes.size()) {
+            std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
         }
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return new File(buffer.str(), fileName);
+        mix(tail);
+
+        hash ^= hash >> 29;
+        hash *= 0x94D049BB133111EBull;
+        return hash ^ (hash >> 32);
     }
 
-    std::unique_ptr<values::NumVal> MK_NUM(int value) {
-        auto return_val = std::make_unique<values::NumVal>();
-        return_val->value = value;
-        return return_val;
+    values::Value MK_NUM(int value) {
+        return values::Value::number(value);
     }
 
-    std::unique_ptr<values::NullVal> MK_NULL() {
-        return std::make_unique<values::NullVal>();
+    values::Value MK_NULL() {
+        return values::Value::null();
     }
 
-    std::unique_ptr<values::NativeFnValue> MK_NATIVE_FN(values::FunctionCall call) {
-        auto return_val = std::make_unique<values::NativeFnValue>();
+    values::Value MK_NATIVE_FN(values::FunctionCall call) {
+        auto return_val = runtime::Heap::make<values::NativeFnValue>();
         return_val->call = call;
-        return return_val;
+        return values::Value::object(return_val);
+    }
+
+    values::Value MK_BOOL(bool value) {
+        return values::Value::boolean(value);
     }
 
-    std::unique_ptr<values::BoolVal> MK_BOOL(bool value) {
-        auto return_val = std::make_unique<values::BoolVal>();
-        return_val->value = value;
-        return return_val;
+    values::Value MK_STRING(const std::string& value) {
+        auto return_val = runtime::Heap::make<values::StringVal>(value);
+        return values::Value::object(return_val);
     }
 
-    std::unique_ptr<values::StringVal> MK_STRING(const std::string& value) {
-        auto return_val = std::make_unique<values::StringVal>();
-        return_val->value = value;
-        return return_val;
+    values::Value MK_STRING_LITERAL(std::string_view text) {
+        auto return_val = runtime::Heap::make<values::StringVal>(values::StringVal::Literal{text});
+        return values::Value::object(return_val);
     }
 }
\ No newline at end of file
@@ -1,36 +1,46 @@
 #pragma once
 #include "runtime/values.hpp"
+#include <string_view>
 
 namespace utils {
-    bool isAlpha(const std::string& str);
+    bool isAlpha(char ch);
 
-    bool isInt(const std::string& str);
+    bool isInt(char ch);
 
-    bool isSkippable(const std::string& str);
+    bool isSkippable(char ch);
 
 
+    // contents is either a view over the mapped file or over buffer (pipes, stdin, anything mmap refuses).
     struct File {
-        std::string contents;
+        std::string_view contents;
         std::string name;
-        File(const std::string& contents, const std::string& name) : contents(contents), name(name) {}
+        File(std::string buffer, const std::string& name) : name(name), buffer(std::move(buffer)) {
+            contents = this->buffer;
+        }
+        File(const char* mapped, std::size_t size, const std::string& name) : contents(mapped, size), name(name), mapped(true) {}
+        ~File();
+
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+    private:
+        std::string buffer;
+        bool mapped = false;
     };
 
-    File* readFile(const std::string& filePath);
+    // "-" reads from stdin.
+    std::unique_ptr<File> readFile(const std::string& filePath);
 
-    std::unique_ptr<runtime::values::NumVal> MK_NUM(int value);
+    // quick 64 bit content hash, eats 8 bytes at a time.
+    std::uint64_t hashBytes(std::string_view bytes);
 
-    std::unique_ptr<runtime::values::NullVal> MK_NULL();
-    
-    std::unique_ptr<runtime::values::NativeFnValue> MK_NATIVE_FN(runtime::values::FunctionCall call);
+    runtime::values::Value MK_NUM(int value);
 
-    std::unique_ptr<runtime::values::BoolVal> MK_BOOL(bool value);
-    std::unique_ptr<runtime::values::StringVal> MK_STRING(const std::string& value);
+    runtime::values::Value MK_NULL();
+    
+    runtime::values::Value MK_NATIVE_FN(runtime::values::FunctionCall call);
 
-    class Break : public std::exception {
-    public:
-        Break() {};
-        const char* what() const noexcept override {
-            return "";
-        }
-    };
+    runtime::values::Value MK_BOOL(bool value);
+    runtime::values::Value MK_STRING(const std::string& value);
+    // doesn't copy, the text has to outlive the string. for literals, which point into the program.
+    runtime::values::Value MK_STRING_LITERAL(std::string_view text);
 }
\ No newline at end of file